@@ -0,0 +1,46 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<size_t>;
+const size_t per_thread = 200000;
+
+//seconds taken by threads appending under own parents or under one shared parent
+double run(size_t threads, bool shared){
+    tree_ tree;
+    auto root = tree.set_root(0);
+    std::vector<tree_::iterator> parents;
+    for(size_t i = 0; i < threads; i++){
+        parents.emplace_back(shared? root : tree.append_child(root, i));
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < threads; i++){
+        workers.emplace_back([&tree, &parents, i](){
+            for(size_t k = 0; k < per_thread; k++){
+                tree.concurrent_append_child(parents[i], i * per_thread + k);
+            }
+        });
+    }
+    for(auto &w:workers){
+        w.join();
+    }
+    std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+    return time.count();
+}
+
+int main(){
+    //scaling depends on a machine
+    const size_t max_threads = std::max<size_t>(4, std::thread::hardware_concurrency());
+    for(size_t threads = 1; threads <= max_threads; threads *= 2){
+        auto separate = run(threads, false);
+        auto shared = run(threads, true);
+        std::cout<< threads << " threads: "
+            << threads * per_thread / separate / 1e6 << " M appends/s under own parents, "
+            << threads * per_thread / shared / 1e6 << " M appends/s under one parent"
+            << std::endl;
+    }
+}
@@ -1,23 +1,364 @@
 #pragma once
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <new>
+#include <iterator>
+#include <cstddef>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <string>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define CXX_GRAPH_HAS_MMAP 1
+#else
+#include <fstream>
+#define CXX_GRAPH_HAS_MMAP 0
+#endif
 
 namespace cxx_graph{
 
-template<class ValT>
+/**
+ * Policies of search of edges between two nodes
+ * Policy keeps node_data in every node and is told about every change
+ * of edges of a node:
+ * on_push(n) after an edge end was appended to edges of n,
+ * on_remove(n, idx) before an end at idx is removed, last end of n takes its place,
+ * on_rebuild(n) after edges of n were set as a whole.
+ * find(n, other) gives an end of n pointing to other or nullptr.
+ */
+namespace adjacency{
+
+/**
+ * Edges are searched by a scan of edges of a node of a smaller degree
+ */
+struct scan{
+    template<class Node>
+    struct node_data{};
+
+    template<class Node>
+    static void on_push(Node*){}
+
+    template<class Node>
+    static void on_remove(Node*, size_t){}
+
+    template<class Node>
+    static void on_rebuild(Node*){}
+
+    template<class Node>
+    static auto find(const Node *n, const Node *other){
+        auto& edges = n->m_edges;
+        auto found = std::find_if(edges.begin(), edges.end(),
+            [other](auto &&edge){ return edge.m_node == other; });
+        return (found != edges.end())? found : nullptr;
+    }
+};
+
+/**
+ * Nodes of a high degree keep a hash index of their edge ends
+ * Search is O(1) on average: it is a lookup in an index of a node
+ * or a scan of at most Threshold ends.
+ * @tparam Threshold degree from which a node keeps an index
+ */
+template<size_t Threshold = 32>
+struct hashed{
+    template<class Node>
+    struct node_data{
+        using index_type = std::unordered_multimap<const Node*, size_t>;
+        std::unique_ptr<index_type> m_adjacency_index; /**< Adjacent node to index of an end */
+    };
+
+    template<class Node>
+    static void on_push(Node *n){
+        auto& edges = n->m_edges;
+        auto& index = n->m_adjacency_index;
+        if(index){
+            index->emplace(edges[edges.size()-1].m_node, edges.size()-1);
+        }else if(edges.size() >= Threshold){
+            on_rebuild(n);
+        }
+    }
+
+    template<class Node>
+    static void on_remove(Node *n, size_t idx){
+        auto& index = n->m_adjacency_index;
+        if(!index){
+            return;
+        }
+        auto& edges = n->m_edges;
+        auto last = edges.size()-1;
+        index->erase(p_entry(*index, edges[idx].m_node, idx));
+        if(idx != last){
+            p_entry(*index, edges[last].m_node, last)->second = idx;
+        }
+    }
+
+    template<class Node>
+    static void on_rebuild(Node *n){
+        auto& edges = n->m_edges;
+        auto& index = n->m_adjacency_index;
+        if(edges.size() < Threshold){
+            index.reset();
+            return;
+        }
+        using index_type = typename node_data<Node>::index_type;
+        index = std::make_unique<index_type>(edges.size());
+        for(size_t i = 0; i < edges.size(); i++){
+            index->emplace(edges[i].m_node, i);
+        }
+    }
+
+    template<class Node>
+    static auto find(const Node *n, const Node *other){
+        auto& index = n->m_adjacency_index;
+        if(!index){
+            return scan::find(n, other);
+        }
+        auto found = index->find(other);
+        return (found != index->end())? n->m_edges.begin()+found->second : nullptr;
+    }
+private:
+    template<class Index, class Node>
+    static auto p_entry(Index &index, const Node *other, size_t idx){
+        auto range = index.equal_range(other);
+        return std::find_if(range.first, range.second,
+            [idx](auto &&entry){ return entry.second == idx; });
+    }
+};
+
+};
+
+/**
+ * Read-only view of a whole file, memory mapped where POSIX mmap is available
+ * and read into memory otherwise
+ */
+class mapped_file{
+    const char* m_data=nullptr;
+    size_t m_size=0;
+#if CXX_GRAPH_HAS_MMAP
+    void* m_mapping=nullptr;
+#else
+    std::vector<char> m_buffer;
+#endif
+public:
+    explicit mapped_file(const std::string &path){
+#if CXX_GRAPH_HAS_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if(fd < 0 || ::fstat(fd, &info) != 0){
+            if(fd >= 0){
+                ::close(fd);
+            }
+            throw std::runtime_error("cannot open "+path);
+        }
+        m_size = static_cast<size_t>(info.st_size);
+        if(m_size){
+            m_mapping = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+        if(m_mapping == MAP_FAILED){
+            m_mapping = nullptr;
+            throw std::runtime_error("cannot map "+path);
+        }
+        m_data = static_cast<const char*>(m_mapping);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if(!file){
+            throw std::runtime_error("cannot open "+path);
+        }
+        m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+#endif
+    }
+    mapped_file(const mapped_file &rhs) = delete;
+    mapped_file& operator=(const mapped_file &rhs) = delete;
+    ~mapped_file(){
+#if CXX_GRAPH_HAS_MMAP
+        if(m_mapping){
+            ::munmap(m_mapping, m_size);
+        }
+#endif
+    }
+    const char* data()const{ return m_data; }
+    size_t size()const{ return m_size; }
+};
+
+/**
+ * Layout of an edge list file
+ */
+enum class edge_list_format{
+    text, /**< Line per edge of two node ids, lines starting with '#' or '%' are comments */
+    binary32, /**< Pairs of node ids as std::uint32_t in native byte order */
+    binary64 /**< Pairs of node ids as std::uint64_t in native byte order */
+};
+
+/**
+ * Distances and parents of nodes reached by a breadth-first search, by node ids
+ */
+struct bfs_result{
+    static constexpr size_t npos = size_t(-1);
+    std::vector<size_t> m_distance; /**< Number of edges from a source, npos if not reached */
+    std::vector<size_t> m_parent; /**< Previous node on a shortest path, source for itself */
+};
+
+template<class ValT, class Adjacency = adjacency::scan>
 class graph{
 public:
     using value_type = ValT;
     struct node;
     struct edge;
 
+    /**
+     * End of an edge stored inline in an edge array of a node
+     */
     struct edge{
-        node* m_first=nullptr, * m_second=nullptr;
+        node* m_node=nullptr; /**< Adjacent node */
+        size_t m_back=0; /**< Index of a reverse edge end in edges of an adjacent node */
+    };
+    /**
+     * Edges of a node, array is taken from the edge arena of a graph
+     */
+    struct edge_list{
+        edge* m_data=nullptr;
+        size_t m_size=0;
+        size_t m_capacity=0;
+        edge* begin()const{ return m_data; }
+        edge* end()const{ return m_data+m_size; }
+        size_t size()const{ return m_size; }
+        edge& operator[](size_t idx)const{ return m_data[idx]; }
     };
-    struct node{
-        using Edges = std::vector<edge*>;
+    struct node: Adjacency::template node_data<node>{
+        using Edges = edge_list;
         Edges m_edges={};
         value_type m_value;
+        size_t m_id=0; /**< Index of a node in a graph, dense */
+        template<class Arg>
+        node(Arg &&val, size_t id)
+            :m_value(std::forward<Arg>(val)), m_id(id)
+        {}
+    };
+
+    /**
+     * Adjacent nodes of a node, a view of its edges
+     * Valid until edges of a node change.
+     */
+    template<class NodeIt>
+    class adjacent_range{
+        const edge *m_begin, *m_end;
+    public:
+        class iterator{
+            const edge* m_edge;
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = NodeIt;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = NodeIt;
+            explicit iterator(const edge *e):m_edge(e){}
+            NodeIt operator*()const{ return NodeIt(m_edge->m_node); }
+            NodeIt operator[](difference_type n)const{ return NodeIt(m_edge[n].m_node); }
+            iterator& operator++(){ ++m_edge; return *this; }
+            iterator operator++(int){ return iterator(m_edge++); }
+            iterator& operator--(){ --m_edge; return *this; }
+            iterator operator--(int){ return iterator(m_edge--); }
+            iterator& operator+=(difference_type n){ m_edge += n; return *this; }
+            iterator& operator-=(difference_type n){ m_edge -= n; return *this; }
+            iterator operator+(difference_type n)const{ return iterator(m_edge+n); }
+            iterator operator-(difference_type n)const{ return iterator(m_edge-n); }
+            difference_type operator-(const iterator &rhs)const{ return m_edge-rhs.m_edge; }
+            bool operator==(const iterator &rhs)const{ return m_edge == rhs.m_edge; }
+            bool operator!=(const iterator &rhs)const{ return m_edge != rhs.m_edge; }
+            bool operator<(const iterator &rhs)const{ return m_edge < rhs.m_edge; }
+            bool operator>(const iterator &rhs)const{ return m_edge > rhs.m_edge; }
+            bool operator<=(const iterator &rhs)const{ return m_edge <= rhs.m_edge; }
+            bool operator>=(const iterator &rhs)const{ return m_edge >= rhs.m_edge; }
+        };
+        adjacent_range(const edge *first, const edge *last)
+            :m_begin(first), m_end(last)
+        {}
+        iterator begin()const{ return iterator(m_begin); }
+        iterator end()const{ return iterator(m_end); }
+        size_t size()const{ return m_end-m_begin; }
+        bool empty()const{ return m_begin == m_end; }
+        NodeIt operator[](size_t idx)const{ return NodeIt(m_begin[idx].m_node); }
+    };
+
+    /**
+     * Allocator of nodes from large blocks with a free list
+     */
+    class node_slab{
+        struct alignas(node) slot{
+            unsigned char m_bytes[sizeof(node)];
+        };
+        std::vector<std::unique_ptr<slot[]>> m_blocks;
+        slot* m_next=nullptr; /**< First unused slot of the last block */
+        slot* m_last=nullptr; /**< End of the last block */
+        std::vector<node*> m_free;
+        size_t m_block_size=64; /**< Size of a next block, doubles */
+    public:
+        /**
+         * Makes room for count nodes in one block
+         */
+        void reserve(size_t count);
+        template<class Arg>
+        node* create(Arg &&val, size_t id);
+        void destroy(node *n);
+    };
+
+    /**
+     * Allocator of edge arrays from large blocks
+     * Freed arrays are kept in free lists by size class,
+     * size class of an array is a power of two not greater than its capacity.
+     */
+    class edge_arena{
+        std::vector<std::unique_ptr<edge[]>> m_blocks;
+        edge* m_next=nullptr; /**< First unused edge of the last block */
+        edge* m_last=nullptr; /**< End of the last block */
+        std::vector<edge*> m_free[sizeof(size_t)*8];
+        size_t m_block_size=1024; /**< Size of a next block, doubles */
+        static size_t p_class(size_t capacity);
+    public:
+        /**
+         * Makes room for count edges in one block
+         */
+        void reserve(size_t count);
+        /**
+         * Gives an array of a power of two capacity
+         */
+        edge* allocate(size_t capacity);
+        /**
+         * Gives an array of an exact capacity, never from free lists
+         */
+        edge* allocate_exact(size_t capacity);
+        void deallocate(edge *edges, size_t capacity);
+    };
+
+    /**
+     * Dense bitmap of nodes keyed by their ids
+     */
+    class visited_set{
+        std::vector<std::uint64_t> m_words;
+    public:
+        /**
+         * Preallocates bits for ids below count
+         */
+        void reserve(size_t count);
+        /**
+         * Marks a node
+         * @return "true" if node was not marked before
+         */
+        bool insert(const node *n);
+        bool insert(size_t id);
+        bool contains(const node *n)const;
+        bool contains(size_t id)const;
     };
 
     class iterator_base{
@@ -32,38 +373,171 @@ public:
         friend bool operator==(const iterator_base& lhs, const iterator_base& rhs){
             return lhs.m_node == rhs.m_node;
         }
+        friend bool operator!=(const iterator_base& lhs, const iterator_base& rhs){
+            return lhs.m_node != rhs.m_node;
+        }
     };
 
+    /**
+     * Breadth-first iterator, end is reached when it compares equal to end()
+     * Discovered nodes are a queue that is also a history for decrement,
+     * copies of an iterator share it, so copying is O(1).
+     */
     class bfs_iterator:public iterator_base{
         using Nodes = std::vector<node*>;
-        Nodes m_nodes;
+        /**
+         * Traversal shared by copies of an iterator
+         */
+        struct state{
+            Nodes m_nodes; /**< Discovered nodes in breadth-first order */
+            visited_set m_visited;
+            size_t m_expanded=0; /**< Number of nodes which neighbours are discovered */
+        };
+        std::shared_ptr<state> m_state;
         size_t m_nodes_idx;
+        void p_start(size_t node_count);
+        void p_swap(bfs_iterator &it);
     public:
         bfs_iterator(node *n);
+        /**
+         * @param n start node
+         * @param node_count number of nodes of a graph to preallocate for
+         */
+        bfs_iterator(node *n, size_t node_count);
         bfs_iterator(const bfs_iterator &it);
         bfs_iterator(bfs_iterator &&it);
+        bfs_iterator& operator=(const bfs_iterator &it);
+        bfs_iterator& operator=(bfs_iterator &&it);
         bfs_iterator& operator++();
         bfs_iterator operator++(int);
         bfs_iterator& operator--();
         bfs_iterator operator--(int);
     };
 
+    /**
+     * Order in which depth-first traversal gives nodes
+     */
+    enum class dfs_order{
+        preorder, /**< Node before nodes discovered from it */
+        postorder /**< Node after all nodes discovered from it */
+    };
+
+    /**
+     * Depth-first iterator, end is reached when it compares equal to end()
+     * Traversal is iterative with an explicit stack, so it is safe on long
+     * paths. Given nodes are a history for decrement, copies of an iterator
+     * share it, so copying is O(1).
+     */
     class dfs_iterator:public iterator_base{
-        std::vector<node*> m_nodes;
+        /**
+         * Node on a stack and position of its next edge
+         */
+        struct frame{
+            node* m_node;
+            size_t m_edge_idx;
+        };
+        /**
+         * Traversal shared by copies of an iterator
+         */
+        struct state{
+            std::vector<node*> m_nodes; /**< Given nodes in traversal order */
+            std::vector<frame> m_stack;
+            visited_set m_visited;
+            dfs_order m_order;
+            bool p_advance();
+        };
+        std::shared_ptr<state> m_state;
+        size_t m_nodes_idx=0;
+        dfs_order m_order=dfs_order::preorder;
+        void p_start(size_t node_count);
     public:
         dfs_iterator(node *n);
         dfs_iterator(const iterator_base &it);
+        /**
+         * @param it start node
+         * @param order order of nodes
+         * @param node_count number of nodes of a graph to preallocate for
+         */
+        dfs_iterator(const iterator_base &it, dfs_order order, size_t node_count=0);
         dfs_iterator& operator++();
         dfs_iterator operator++(int);
         dfs_iterator& operator--();
         dfs_iterator operator--(int);
     };
 
+    /**
+     * Read-only compressed sparse row snapshot of a graph
+     * Neighbours of node i are targets()[offsets()[i]..offsets()[i+1]),
+     * nodes are given by ids, values are stored contiguously.
+     */
+    class frozen{
+        friend class graph;
+        std::vector<size_t> m_offsets;
+        std::vector<size_t> m_targets;
+        std::vector<value_type> m_values;
+    public:
+        /**
+         * Neighbour ids of a node
+         */
+        struct neighbours_range{
+            const size_t *m_begin, *m_end;
+            const size_t* begin()const{ return m_begin; }
+            const size_t* end()const{ return m_end; }
+            size_t size()const{ return m_end-m_begin; }
+        };
+        size_t size()const;
+        /**
+         * Number of edge ends, each edge is counted at both of its nodes
+         */
+        size_t edge_count()const;
+        size_t degree(size_t id)const;
+        neighbours_range neighbours(size_t id)const;
+        const value_type& value(size_t id)const;
+        value_type& value(size_t id);
+        const std::vector<size_t>& offsets()const;
+        const std::vector<size_t>& targets()const;
+        const std::vector<value_type>& values()const;
+        /**
+         * Breadth-first traversal
+         * @param source id of a start node
+         * @param fn called with id of each reached node
+         */
+        template<class Fn>
+        void bfs(size_t source, Fn fn)const;
+        /**
+         * Depth-first traversal
+         * @param source id of a start node
+         * @param fn called with id of each reached node
+         * @param order order of nodes
+         */
+        template<class Fn>
+        void dfs(size_t source, Fn fn, dfs_order order=dfs_order::preorder)const;
+        /**
+         * Level-synchronous breadth-first search on many threads
+         * @param source id of a start node
+         * @param threads number of threads, all cores if 0
+         */
+        bfs_result parallel_bfs(size_t source, size_t threads=0)const;
+        /**
+         * Labels of connected components by node ids, on many threads
+         * @param threads number of threads, all cores if 0
+         */
+        std::vector<size_t> connected_components(size_t threads=0)const;
+    };
+
     using default_it = bfs_iterator;
 public:
     graph();
+    /**
+     * Copies nodes and edges, ids of nodes are kept
+     */
     graph(const graph &rhs);
+    /**
+     * Takes nodes and edges of rhs in O(1), rhs is left empty
+     */
     graph(graph &&rhs);
+    graph& operator=(const graph &rhs);
+    graph& operator=(graph &&rhs);
     ~graph();
 
 
@@ -72,215 +546,1406 @@ public:
 
     template<class Arg>
     default_it add_adjacent(iterator_base &it, Arg &&val);
+    /**
+     * Adds an edge between two existing nodes, loops and parallel edges are allowed
+     * @return end of an edge in edges of one, valid until its edges change
+     */
+    const edge* connect(const iterator_base &one, const iterator_base &two);
+    /**
+     * Loads a graph from an edge list file
+     * File is memory mapped and parsed in parallel chunks, degrees are counted
+     * and edges are placed into one block in two passes over parsed edges.
+     * Node ids of a graph are ids of a file, nodes have default values.
+     * @param path file to load
+     * @param format layout of a file
+     * @param threads number of threads, all cores if 0
+     */
+    static graph load_edge_list(const std::string &path,
+        edge_list_format format=edge_list_format::text, size_t threads=0);
 
+    /**
+     * Erases a node with its edges in O(deg)
+     * Last node takes id of an erased one.
+     */
     void erase(iterator_base &it);
+    /**
+     * Erases a batch of nodes, edges between them are not unlinked one by one
+     * @param first begin of a range of node iterators, repeated nodes are erased once
+     * @param last end of a range of node iterators
+     * @return number of erased nodes
+     */
+    template<class It>
+    size_t erase_many(It first, It last);
+    /**
+     * Erases all nodes in O(V), memory of nodes and edges is freed
+     */
+    void clear();
 
+    /**
+     * Preallocates nodes and edge ends, so building a graph of this size
+     * takes a few large allocations
+     * @param node_count number of nodes
+     * @param edge_count number of edges, each takes two edge ends
+     */
+    void reserve(size_t node_count, size_t edge_count);
+
+    /**
+     * Breadth-first traversal from a node, preallocated for all nodes
+     * of a graph, so steps do not allocate
+     */
+    bfs_iterator bfs(const iterator_base &it)const;
+    /**
+     * Depth-first traversal from a node, preallocated for all nodes
+     * of a graph, so steps do not allocate
+     */
+    dfs_iterator dfs(const iterator_base &it, dfs_order order=dfs_order::preorder)const;
+    /**
+     * End of traversals
+     */
+    iterator_base end()const;
+    size_t size()const;
+    /**
+     * Id of a node, dense in [0, size())
+     */
+    static size_t id(const iterator_base &it);
+    /**
+     * Node by its id
+     */
+    default_it at(size_t id)const;
+    /**
+     * Makes compressed sparse row snapshot of a graph, ids of nodes are kept
+     */
+    frozen freeze()const;
+    /**
+     * Level-synchronous breadth-first search on many threads
+     * Levels switch between top-down steps, which expand a frontier, and
+     * bottom-up steps, which look for a parent of every unreached node,
+     * whichever has fewer edges to check. Distances do not depend on
+     * a number of threads, parents may if a node has several of them.
+     * @param source start node
+     * @param threads number of threads, all cores if 0
+     */
+    bfs_result parallel_bfs(const iterator_base &source, size_t threads=0)const;
+    /**
+     * Labels of connected components by node ids, on many threads
+     * Edges are united in a lock-free union-find, a root is linked under
+     * a smaller one, so a root of a component is its smallest id.
+     * Labels are dense and numbered in order of smallest ids of components,
+     * so they do not depend on a number of threads.
+     * @param threads number of threads, all cores if 0
+     */
+    std::vector<size_t> connected_components(size_t threads=0)const;
+
+    /**
+     * Adjacent nodes of a node, without allocation
+     * @return view of adjacent nodes, valid until edges of a node change
+     */
     template<class NodeIt>
-    static std::vector<NodeIt> get_adjacent(NodeIt node_it);
+    static adjacent_range<NodeIt> get_adjacent(NodeIt node_it);
 
     template<class NodeIt>
     static bool is_adjacent(NodeIt node_one_it, NodeIt node_two_it);
+    /**
+     * Finds an edge between two nodes
+     * Search goes from a node of a smaller degree through the Adjacency policy.
+     * @return end of an edge in edges of node_one_it, nullptr if there is none
+     */
+    template<class NodeIt>
+    static const edge* find_edge(NodeIt node_one_it, NodeIt node_two_it);
 private:
     std::vector<node*> m_nodes;
+    node_slab m_node_slab;
+    edge_arena m_edge_arena;
+    /**
+     * Appends an edge end to edges of a node, grows its array if needed
+     */
+    void p_push_edge(node *n, node *other, size_t back);
+    /**
+     * Adds both ends of an edge
+     */
+    void p_link(node *one, node *two);
+    /**
+     * Removes an edge end by its index, last end of a node takes its place
+     */
+    void p_remove_edge(node *n, size_t idx);
+    /**
+     * Frees a node which edges are already unlinked
+     */
+    void p_release(node *n);
+    void p_swap(graph &rhs);
+    /**
+     * Calls fn(first, last, worker) on chunks of [0, count) on many threads
+     */
+    template<class Fn>
+    static void p_parallel_for(size_t count, size_t threads, Fn fn, size_t grain=1024);
+    /**
+     * Number of threads to use, all cores if 0
+     */
+    static size_t p_threads(size_t threads);
+    /**
+     * Parses text edge list into flat pairs of ids, a vector per piece of a file
+     */
+    static std::vector<std::vector<std::uint64_t>> p_parse_edge_list(const char *data,
+        size_t size, size_t threads);
+    /**
+     * Builds a graph from flat pairs of ids
+     * @param pieces ranges of flat pairs, processed in parallel
+     */
+    template<class Id>
+    static graph p_from_edge_list(const std::vector<std::pair<const Id*, const Id*>> &pieces,
+        size_t threads);
+    /**
+     * Breadth-first search over node ids
+     * @param degree degree(id) gives number of edge ends of a node
+     * @param neighbours neighbours(id, fn) calls fn(id) for adjacent nodes until it returns "true"
+     */
+    template<class Degree, class Neighbours>
+    static bfs_result p_parallel_bfs(size_t count, size_t edge_ends, size_t source,
+        size_t threads, Degree degree, Neighbours neighbours);
+    /**
+     * Connected components over node ids
+     * @param neighbours neighbours(id, fn) calls fn(id) for adjacent nodes
+     */
+    template<class Neighbours>
+    static std::vector<size_t> p_connected_components(size_t count, size_t threads,
+        Neighbours neighbours);
 };
 
-template<class ValT>
-graph<ValT>::iterator_base::iterator_base(node *n){
+template<class ValT, class Adjacency>
+graph<ValT, Adjacency>::iterator_base::iterator_base(node *n){
     this->m_node = n;
 }
 
-template<class ValT>
-graph<ValT>::iterator_base::iterator_base(const iterator_base &it)
+template<class ValT, class Adjacency>
+graph<ValT, Adjacency>::iterator_base::iterator_base(const iterator_base &it)
     :iterator_base(it.m_node)
 {}
 
-template<class ValT>
-auto graph<ValT>::iterator_base::operator*()const
-    ->const typename graph<ValT>::value_type& 
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::iterator_base::operator*()const
+    ->const typename graph<ValT, Adjacency>::value_type& 
 {
     return m_node->m_value;
 }
 
-template<class ValT>
-auto graph<ValT>::iterator_base::operator*()
-    ->typename graph<ValT>::value_type& 
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::iterator_base::operator*()
+    ->typename graph<ValT, Adjacency>::value_type& 
 {
     return m_node->m_value;
 }
 
-template<class ValT>
-graph<ValT>::bfs_iterator::bfs_iterator(node *n)
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::visited_set::reserve(size_t count){
+    if(m_words.size()*64 < count){
+        m_words.resize((count+63)/64);
+    }
+}
+
+template<class ValT, class Adjacency>
+bool graph<ValT, Adjacency>::visited_set::insert(const node *n){
+    return insert(n->m_id);
+}
+
+template<class ValT, class Adjacency>
+bool graph<ValT, Adjacency>::visited_set::insert(size_t id){
+    auto word = id/64;
+    auto bit = std::uint64_t(1) << (id%64);
+    if(word >= m_words.size()){
+        m_words.resize(std::max(word+1, m_words.size()*2));
+    }
+    if(m_words[word] & bit){
+        return false;
+    }
+    m_words[word] |= bit;
+    return true;
+}
+
+template<class ValT, class Adjacency>
+bool graph<ValT, Adjacency>::visited_set::contains(const node *n)const{
+    return contains(n->m_id);
+}
+
+template<class ValT, class Adjacency>
+bool graph<ValT, Adjacency>::visited_set::contains(size_t id)const{
+    auto word = id/64;
+    return word < m_words.size() && (m_words[word] >> (id%64) & 1);
+}
+
+template<class ValT, class Adjacency>
+graph<ValT, Adjacency>::bfs_iterator::bfs_iterator(node *n)
+    :iterator_base(n)
+{
+    this->m_nodes_idx = 0;
+}
+template<class ValT, class Adjacency>
+graph<ValT, Adjacency>::bfs_iterator::bfs_iterator(node *n, size_t node_count)
     :iterator_base(n)
 {
-    this->m_nodes.emplace_back(n);
     this->m_nodes_idx = 0;
+    if(n){
+        p_start(node_count);
+    }
 }
-template<class ValT>
-graph<ValT>::bfs_iterator::bfs_iterator(const bfs_iterator &it)
+template<class ValT, class Adjacency>
+graph<ValT, Adjacency>::bfs_iterator::bfs_iterator(const bfs_iterator &it)
     :iterator_base(it.m_node)
 {
-    this->m_nodes = it.m_nodes;
+    this->m_state = it.m_state;
     this->m_nodes_idx = it.m_nodes_idx;
 }
-template<class ValT>
-graph<ValT>::bfs_iterator::bfs_iterator(bfs_iterator &&it)
+template<class ValT, class Adjacency>
+graph<ValT, Adjacency>::bfs_iterator::bfs_iterator(bfs_iterator &&it)
     :iterator_base(it)
 {
-    this->m_nodes = std::move(it.m_nodes);
+    this->m_state = std::move(it.m_state);
     this->m_nodes_idx = std::move(it.m_nodes_idx);
 }
 
-template<class ValT>
-auto graph<ValT>::bfs_iterator::operator++()
-    ->typename graph<ValT>::bfs_iterator& 
-{
-    const node* node = *(m_nodes.begin()+m_nodes_idx);
-    const auto& edges = node->m_edges;
-    auto other_nodes_it = get_adjacent(*this);
-    std::vector<struct node*> other_nodes_ptr;
-    other_nodes_ptr.reserve(other_nodes_it.size());
-    std::transform(other_nodes_it.begin(), other_nodes_it.end(), std::back_inserter(other_nodes_ptr), 
-        [](auto &&node_it){ return node_it.m_node; });
-    m_nodes.reserve(m_nodes.size()+other_nodes_ptr.size());
-    std::copy_if(other_nodes_ptr.begin(), other_nodes_ptr.end(), std::back_inserter(m_nodes),
-        [this](auto &&node_ptr){
-            return std::find(this->m_nodes.begin(), this->m_nodes.end(), node_ptr) == m_nodes.end();
-        });
-    this->m_nodes_idx++;
-    this->m_node = *(m_nodes.begin()+m_nodes_idx);
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::bfs_iterator::operator=(const bfs_iterator &it)
+    ->typename graph<ValT, Adjacency>::bfs_iterator&
+{
+    bfs_iterator copy(it);
+    p_swap(copy);
+    return *this;
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::bfs_iterator::operator=(bfs_iterator &&it)
+    ->typename graph<ValT, Adjacency>::bfs_iterator&
+{
+    bfs_iterator taken(std::move(it));
+    p_swap(taken);
     return *this;
 }
 
-template<class ValT>
-auto graph<ValT>::bfs_iterator::operator++(int)
-    ->typename graph<ValT>::bfs_iterator
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::bfs_iterator::p_swap(bfs_iterator &it){
+    std::swap(this->m_node, it.m_node);
+    std::swap(m_state, it.m_state);
+    std::swap(m_nodes_idx, it.m_nodes_idx);
+}
+
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::bfs_iterator::p_start(size_t node_count){
+    m_state = std::make_shared<state>();
+    m_state->m_nodes.reserve(node_count);
+    m_state->m_visited.reserve(node_count);
+    m_state->m_nodes.emplace_back(this->m_node);
+    m_state->m_visited.insert(this->m_node);
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::bfs_iterator::operator++()
+    ->typename graph<ValT, Adjacency>::bfs_iterator& 
+{
+    if(!m_state){
+        if(!this->m_node){
+            throw std::out_of_range("end iterator incremented");
+        }
+        p_start(0);
+    }
+    auto& s = *m_state;
+    //nodes are discovered lazily, only as far as this iterator needs
+    while(m_nodes_idx+1 >= s.m_nodes.size() && s.m_expanded < s.m_nodes.size()){
+        const node* node = s.m_nodes[s.m_expanded++];
+        for(auto& edge:node->m_edges){
+            auto other = edge.m_node;
+            if(s.m_visited.insert(other)){
+                s.m_nodes.emplace_back(other);
+            }
+        }
+    }
+    if(m_nodes_idx < s.m_nodes.size()){
+        m_nodes_idx++;
+    }
+    this->m_node = (m_nodes_idx < s.m_nodes.size())? s.m_nodes[m_nodes_idx] : nullptr;
+    return *this;
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::bfs_iterator::operator++(int)
+    ->typename graph<ValT, Adjacency>::bfs_iterator
 {
     auto copy = *this;
     ++(*this);
     return copy;
 }
 
-template<class ValT>
-auto graph<ValT>::bfs_iterator::operator--()
-    ->typename graph<ValT>::bfs_iterator&
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::bfs_iterator::operator--()
+    ->typename graph<ValT, Adjacency>::bfs_iterator&
 {
+    if(!m_state || !m_nodes_idx){
+        throw std::out_of_range("empty iterator decremented");
+    }
     m_nodes_idx--;
-    if(m_nodes_idx >= m_nodes.size()){
+    this->m_node = m_state->m_nodes[m_nodes_idx];
+    return *this;
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::bfs_iterator::operator--(int)
+    ->typename graph<ValT, Adjacency>::bfs_iterator
+{
+    auto copy = *this;
+    --(*this);
+    return copy;
+}
+
+template<class ValT, class Adjacency>
+graph<ValT, Adjacency>::dfs_iterator::dfs_iterator(node *n)
+    :iterator_base(n)
+{}
+
+template<class ValT, class Adjacency>
+graph<ValT, Adjacency>::dfs_iterator::dfs_iterator(const iterator_base &it)
+    :iterator_base(it)
+{}
+
+template<class ValT, class Adjacency>
+graph<ValT, Adjacency>::dfs_iterator::dfs_iterator(const iterator_base &it, dfs_order order, size_t node_count)
+    :iterator_base(it)
+{
+    m_order = order;
+    //first node of postorder is known only after descending
+    if(this->m_node && (node_count || order == dfs_order::postorder)){
+        p_start(node_count);
+    }
+}
+
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::dfs_iterator::p_start(size_t node_count){
+    m_state = std::make_shared<state>();
+    auto& s = *m_state;
+    s.m_order = m_order;
+    s.m_nodes.reserve(node_count);
+    s.m_visited.reserve(node_count);
+    s.m_visited.insert(this->m_node);
+    s.m_stack.push_back({this->m_node, 0});
+    if(m_order == dfs_order::preorder){
+        s.m_nodes.emplace_back(this->m_node);
+    }else{
+        s.p_advance();
+        this->m_node = s.m_nodes.front();
+    }
+}
+
+template<class ValT, class Adjacency>
+bool graph<ValT, Adjacency>::dfs_iterator::state::p_advance(){
+    while(!m_stack.empty()){
+        auto& top = m_stack.back();
+        auto& edges = top.m_node->m_edges;
+        if(top.m_edge_idx == edges.size()){
+            auto done = top.m_node;
+            m_stack.pop_back();
+            if(m_order == dfs_order::postorder){
+                m_nodes.emplace_back(done);
+                return true;
+            }
+            continue;
+        }
+        auto other = edges[top.m_edge_idx++].m_node;
+        if(!m_visited.insert(other)){
+            continue;
+        }
+        m_stack.push_back({other, 0});
+        if(m_order == dfs_order::preorder){
+            m_nodes.emplace_back(other);
+            return true;
+        }
+    }
+    return false;
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::dfs_iterator::operator++()
+    ->typename graph<ValT, Adjacency>::dfs_iterator&
+{
+    if(!m_state){
+        if(!this->m_node){
+            throw std::out_of_range("end iterator incremented");
+        }
+        p_start(0);
+    }
+    auto& s = *m_state;
+    if(m_nodes_idx+1 >= s.m_nodes.size()){
+        s.p_advance();
+    }
+    if(m_nodes_idx < s.m_nodes.size()){
+        m_nodes_idx++;
+    }
+    this->m_node = (m_nodes_idx < s.m_nodes.size())? s.m_nodes[m_nodes_idx] : nullptr;
+    return *this;
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::dfs_iterator::operator++(int)
+    ->typename graph<ValT, Adjacency>::dfs_iterator
+{
+    auto copy = *this;
+    ++(*this);
+    return copy;
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::dfs_iterator::operator--()
+    ->typename graph<ValT, Adjacency>::dfs_iterator&
+{
+    if(!m_state || !m_nodes_idx){
         throw std::out_of_range("empty iterator decremented");
     }
-    this->m_node = *(m_nodes.begin()+m_nodes_idx);
+    m_nodes_idx--;
+    this->m_node = m_state->m_nodes[m_nodes_idx];
     return *this;
 }
 
-template<class ValT>
-auto graph<ValT>::bfs_iterator::operator--(int)
-    ->typename graph<ValT>::bfs_iterator
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::dfs_iterator::operator--(int)
+    ->typename graph<ValT, Adjacency>::dfs_iterator
 {
     auto copy = *this;
     --(*this);
     return copy;
 }
 
+template<class ValT, class Adjacency>
+graph<ValT, Adjacency>::graph(){
+}
 
-template<class ValT>
-graph<ValT>::graph(){
+template<class ValT, class Adjacency>
+graph<ValT, Adjacency>::graph(const graph &rhs){
+    size_t edge_ends = 0;
+    for(auto node:rhs.m_nodes){
+        edge_ends += node->m_edges.size();
+    }
+    m_nodes.reserve(rhs.m_nodes.size());
+    m_node_slab.reserve(rhs.m_nodes.size());
+    m_edge_arena.reserve(edge_ends);
+    try{
+        for(auto node:rhs.m_nodes){
+            m_nodes.emplace_back(m_node_slab.create(node->m_value, node->m_id));
+        }
+        //ids are kept, so they map edge ends to copied nodes
+        for(auto node:rhs.m_nodes){
+            auto& from = node->m_edges;
+            auto& to = m_nodes[node->m_id]->m_edges;
+            if(!from.size()){
+                continue;
+            }
+            to.m_data = m_edge_arena.allocate_exact(from.size());
+            to.m_size = to.m_capacity = from.size();
+            for(size_t i = 0; i < from.size(); i++){
+                to[i] = {m_nodes[from[i].m_node->m_id], from[i].m_back};
+            }
+            Adjacency::on_rebuild(m_nodes[node->m_id]);
+        }
+    }catch(...){
+        //edge arrays go with the arena, but slab does not run destructors of nodes
+        for(auto node:m_nodes){
+            m_node_slab.destroy(node);
+        }
+        throw;
+    }
 }
 
-template<class ValT>
-graph<ValT>::graph(const graph &rhs){
+template<class ValT, class Adjacency>
+graph<ValT, Adjacency>::graph(graph &&rhs){
+    p_swap(rhs);
 }
 
-template<class ValT>
-graph<ValT>::graph(graph &&rhs){
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::operator=(const graph &rhs)
+    ->graph<ValT, Adjacency>&
+{
+    if(this != &rhs){
+        graph copy(rhs);
+        p_swap(copy);
+    }
+    return *this;
 }
 
-template<class ValT>
-graph<ValT>::~graph(){
-    auto node_it = m_nodes.begin();
-    while (node_it != m_nodes.end()) {
-        auto& node = *node_it;
-        auto node_it_graph = iterator_base(node);
-        erase(node_it_graph);
-        node_it++;
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::operator=(graph &&rhs)
+    ->graph<ValT, Adjacency>&
+{
+    if(this != &rhs){
+        graph taken(std::move(rhs));
+        p_swap(taken);
     }
+    return *this;
+}
+
+template<class ValT, class Adjacency>
+graph<ValT, Adjacency>::~graph(){
+    clear();
 }
 
-template<class ValT>
+template<class ValT, class Adjacency>
 template<class Arg>
-auto graph<ValT>::insert(Arg &&val)
-    ->typename graph<ValT>::default_it
+auto graph<ValT, Adjacency>::insert(Arg &&val)
+    ->typename graph<ValT, Adjacency>::default_it
 {
-    auto new_node = new struct node();
-    new_node->m_value = std::forward<Arg>(std::move(val));
+    auto new_node = m_node_slab.create(std::forward<Arg>(val), m_nodes.size());
     m_nodes.emplace_back(new_node);
-    return typename graph<ValT>::default_it(new_node);
+    return typename graph<ValT, Adjacency>::default_it(new_node);
 }
 
-template<class ValT>
+template<class ValT, class Adjacency>
 template<class Arg>
-auto graph<ValT>::add_adjacent(iterator_base &it, Arg &&val)
-    ->typename graph<ValT>::default_it
+auto graph<ValT, Adjacency>::add_adjacent(iterator_base &it, Arg &&val)
+    ->typename graph<ValT, Adjacency>::default_it
 {
     auto& node = it.m_node;
-    auto new_node = new struct node();
-    new_node->m_value = std::forward<Arg>(std::move(val));
-    auto edge = new struct edge();
-    edge->m_first = node;
-    edge->m_second = new_node;
-    new_node->m_edges.emplace_back(edge);
-    node->m_edges.emplace_back(edge);
-    return typename graph<ValT>::default_it(new_node);
-}
-
-template<class ValT>
-void graph<ValT>::erase(iterator_base &it){
-    auto& node = it.m_node;
-    auto& edges = node->m_edges;
-    auto edges_it = edges.begin();
-    while(edges_it != edges.end()){
-        auto& edge = *edges_it;
-        auto& other_end = (edge->m_first == node)?
-            edge->m_second : edge->m_first;
-        auto& other_end_edges = other_end->m_edges;
-        auto other_end_edge_it = other_end_edges.begin();
-        while(other_end_edge_it != other_end_edges.end()){
-            auto& other_end_edge = *other_end_edge_it;
-            if(other_end_edge == edge){
-                other_end_edge_it = other_end_edges.erase(other_end_edge_it);
-                break;
+    auto new_node = m_node_slab.create(std::forward<Arg>(val), m_nodes.size());
+    m_nodes.emplace_back(new_node);
+    p_link(node, new_node);
+    return typename graph<ValT, Adjacency>::default_it(new_node);
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::connect(const iterator_base &one, const iterator_base &two)
+    ->const typename graph<ValT, Adjacency>::edge*
+{
+    p_link(one.m_node, two.m_node);
+    auto& edges = one.m_node->m_edges;
+    //second end of a loop is the last one
+    return &edges[edges.size()-1-(one.m_node == two.m_node)];
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::load_edge_list(const std::string &path,
+    edge_list_format format, size_t threads)
+    ->graph<ValT, Adjacency>
+{
+    threads = p_threads(threads);
+    mapped_file file(path);
+    auto load_binary = [&](auto id){
+        using Id = decltype(id);
+        if(file.size()%(2*sizeof(Id))){
+            throw std::runtime_error("size of "+path+" is not a multiple of an edge");
+        }
+        auto first = reinterpret_cast<const Id*>(file.data());
+        auto count = file.size()/sizeof(Id);
+        std::vector<std::pair<const Id*, const Id*>> pieces;
+        const size_t piece = std::max<size_t>(2, count/(threads*4)/2*2);
+        for(size_t i = 0; i < count; i += piece){
+            pieces.emplace_back(first+i, first+std::min(count, i+piece));
+        }
+        return p_from_edge_list(pieces, threads);
+    };
+    switch(format){
+    case edge_list_format::binary32:
+        return load_binary(std::uint32_t());
+    case edge_list_format::binary64:
+        return load_binary(std::uint64_t());
+    default:
+        break;
+    }
+    auto parsed = p_parse_edge_list(file.data(), file.size(), threads);
+    std::vector<std::pair<const std::uint64_t*, const std::uint64_t*>> pieces;
+    for(auto& ids:parsed){
+        pieces.emplace_back(ids.data(), ids.data()+ids.size());
+    }
+    return p_from_edge_list(pieces, threads);
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::p_parse_edge_list(const char *data, size_t size, size_t threads)
+    ->std::vector<std::vector<std::uint64_t>>
+{
+    //pieces start after a line break, so no line is split
+    const size_t count = std::max<size_t>(1, std::min(threads*4, size/(1 << 16)));
+    std::vector<size_t> starts = {0};
+    for(size_t i = 1; i < count; i++){
+        auto pos = std::max(starts.back(), size*i/count);
+        while(pos < size && data[pos-1] != '\n'){
+            pos++;
+        }
+        starts.emplace_back(pos);
+    }
+    starts.emplace_back(size);
+    std::vector<std::vector<std::uint64_t>> result(count);
+    std::atomic<bool> malformed(false);
+    p_parallel_for(count, threads, [&](size_t first, size_t last, size_t){
+        for(auto piece = first; piece < last; piece++){
+            auto& ids = result[piece];
+            ids.reserve((starts[piece+1]-starts[piece])/4);
+            auto pos = data+starts[piece], end = data+starts[piece+1];
+            auto skip_blank = [&](){
+                while(pos != end && (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == ',')){
+                    pos++;
+                }
+            };
+            auto parse_id = [&](){
+                if(pos == end || *pos < '0' || *pos > '9'){
+                    malformed = true;
+                    return std::uint64_t(0);
+                }
+                std::uint64_t id = 0;
+                for(; pos != end && *pos >= '0' && *pos <= '9'; pos++){
+                    id = id*10+std::uint64_t(*pos-'0');
+                }
+                return id;
+            };
+            while(pos != end && !malformed){
+                skip_blank();
+                if(pos != end && *pos != '\n' && *pos != '#' && *pos != '%'){
+                    ids.emplace_back(parse_id());
+                    skip_blank();
+                    ids.emplace_back(parse_id());
+                }
+                //rest of a line, e.g. a weight or a comment
+                while(pos != end && *pos != '\n'){
+                    pos++;
+                }
+                if(pos != end){
+                    pos++;
+                }
             }
         }
-        delete edge;
-        edges_it = edges.erase(edges_it);
+    }, 1);
+    if(malformed){
+        throw std::runtime_error("malformed edge list");
     }
-    delete node;
+    return result;
 }
 
-template<class ValT>
-template<class NodeIt>
-auto graph<ValT>::get_adjacent(NodeIt node_it)
-    ->std::vector<NodeIt>
-{
-    const auto& node = node_it.m_node;
-    const auto& edges = node->m_edges;
-    std::vector<NodeIt> result;
-    result.reserve(edges.size());
-    std::transform(edges.begin(), edges.end(), std::back_inserter(result),
-        [&node](auto &&edge){
-            return (edge->m_first == node)? edge->m_second : edge->m_first;
+template<class ValT, class Adjacency>
+template<class Id>
+auto graph<ValT, Adjacency>::p_from_edge_list(
+    const std::vector<std::pair<const Id*, const Id*>> &pieces, size_t threads)
+    ->graph<ValT, Adjacency>
+{
+    std::vector<size_t> max_ids(pieces.size(), 0);
+    size_t edge_ends = 0;
+    for(auto& piece:pieces){
+        edge_ends += piece.second-piece.first;
+    }
+    p_parallel_for(pieces.size(), threads, [&](size_t first, size_t last, size_t){
+        for(auto piece = first; piece < last; piece++){
+            for(auto id = pieces[piece].first; id != pieces[piece].second; id++){
+                max_ids[piece] = std::max<size_t>(max_ids[piece], *id+1);
+            }
+        }
+    }, 1);
+    const size_t count = max_ids.empty()? 0 : *std::max_element(max_ids.begin(), max_ids.end());
+    graph result;
+    result.m_nodes.reserve(count);
+    result.m_node_slab.reserve(count);
+    for(size_t id = 0; id < count; id++){
+        result.m_nodes.emplace_back(result.m_node_slab.create(value_type(), id));
+    }
+    //first pass counts degrees, second one places both ends of every edge
+    std::vector<std::atomic<size_t>> cursors(count);
+    p_parallel_for(pieces.size(), threads, [&](size_t first, size_t last, size_t){
+        for(auto piece = first; piece < last; piece++){
+            for(auto id = pieces[piece].first; id != pieces[piece].second; id++){
+                cursors[*id].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }, 1);
+    //edges of all nodes are one block, cursors become absolute positions in it
+    auto data = edge_ends? result.m_edge_arena.allocate_exact(edge_ends) : nullptr;
+    std::vector<size_t> begins(count);
+    size_t begin = 0;
+    for(size_t id = 0; id < count; id++){
+        auto& edges = result.m_nodes[id]->m_edges;
+        auto degree = cursors[id].load(std::memory_order_relaxed);
+        if(degree){
+            edges.m_data = data+begin;
+            edges.m_capacity = degree;
+        }
+        begins[id] = begin;
+        cursors[id].store(begin, std::memory_order_relaxed);
+        begin += degree;
+    }
+    auto& nodes = result.m_nodes;
+    p_parallel_for(pieces.size(), threads, [&](size_t first, size_t last, size_t){
+        for(auto piece = first; piece < last; piece++){
+            for(auto id = pieces[piece].first; id != pieces[piece].second; id += 2){
+                auto one = cursors[id[0]].fetch_add(1, std::memory_order_relaxed);
+                auto two = cursors[id[1]].fetch_add(1, std::memory_order_relaxed);
+                data[one] = {nodes[id[1]], two-begins[id[1]]};
+                data[two] = {nodes[id[0]], one-begins[id[0]]};
+            }
+        }
+    }, 1);
+    p_parallel_for(count, threads, [&](size_t first, size_t last, size_t){
+        for(auto id = first; id < last; id++){
+            nodes[id]->m_edges.m_size = nodes[id]->m_edges.m_capacity;
+            Adjacency::on_rebuild(nodes[id]);
+        }
     });
     return result;
 }
 
-template<class ValT>
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::erase(iterator_base &it){
+    auto node = it.m_node;
+    //removal keeps reverse indices of moved ends, so later ends stay valid
+    for(auto& edge:node->m_edges){
+        if(edge.m_node != node){
+            p_remove_edge(edge.m_node, edge.m_back);
+        }
+    }
+    p_release(node);
+}
+
+template<class ValT, class Adjacency>
+template<class It>
+size_t graph<ValT, Adjacency>::erase_many(It first, It last){
+    visited_set erased;
+    erased.reserve(m_nodes.size());
+    std::vector<node*> nodes;
+    for(; first != last; ++first){
+        const iterator_base& it = *first;
+        if(erased.insert(it.m_node)){
+            nodes.emplace_back(it.m_node);
+        }
+    }
+    //ids change only after all edges are unlinked
+    for(auto node:nodes){
+        for(auto& edge:node->m_edges){
+            if(!erased.contains(edge.m_node)){
+                p_remove_edge(edge.m_node, edge.m_back);
+            }
+        }
+    }
+    for(auto node:nodes){
+        p_release(node);
+    }
+    return nodes.size();
+}
+
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::clear(){
+    //blocks of nodes and edges are freed by allocators, not one by one
+    for(auto node:m_nodes){
+        node->~node();
+    }
+    m_nodes = std::vector<node*>();
+    m_node_slab = node_slab();
+    m_edge_arena = edge_arena();
+}
+
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::reserve(size_t node_count, size_t edge_count){
+    m_nodes.reserve(node_count);
+    m_node_slab.reserve(node_count);
+    //arrays grow by doubling, so they take up to twice of edge ends
+    m_edge_arena.reserve(4*edge_count);
+}
+
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::p_push_edge(node *n, node *other, size_t back){
+    auto& edges = n->m_edges;
+    if(edges.m_size == edges.m_capacity){
+        //arrays of exact capacity grow to a power of two too
+        size_t capacity = 1;
+        while(capacity <= edges.m_size){
+            capacity *= 2;
+        }
+        auto data = m_edge_arena.allocate(capacity);
+        std::copy(edges.begin(), edges.end(), data);
+        m_edge_arena.deallocate(edges.m_data, edges.m_capacity);
+        edges.m_data = data;
+        edges.m_capacity = capacity;
+    }
+    edges.m_data[edges.m_size++] = {other, back};
+    Adjacency::on_push(n);
+}
+
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::p_link(node *one, node *two){
+    auto one_idx = one->m_edges.size();
+    //both ends of a loop are in one array
+    auto two_idx = two->m_edges.size()+(one == two);
+    p_push_edge(one, two, two_idx);
+    p_push_edge(two, one, one_idx);
+}
+
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::p_remove_edge(node *n, size_t idx){
+    auto& edges = n->m_edges;
+    Adjacency::on_remove(n, idx);
+    auto last = --edges.m_size;
+    if(idx == last){
+        return;
+    }
+    auto& moved = edges[idx] = edges[last];
+    moved.m_node->m_edges[moved.m_back].m_back = idx;
+}
+
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::p_release(node *n){
+    auto& edges = n->m_edges;
+    m_edge_arena.deallocate(edges.m_data, edges.m_capacity);
+    //last node takes id of an erased one, so ids stay dense
+    auto last = m_nodes.back();
+    last->m_id = n->m_id;
+    m_nodes[n->m_id] = last;
+    m_nodes.pop_back();
+    m_node_slab.destroy(n);
+}
+
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::p_swap(graph &rhs){
+    std::swap(m_nodes, rhs.m_nodes);
+    std::swap(m_node_slab, rhs.m_node_slab);
+    std::swap(m_edge_arena, rhs.m_edge_arena);
+}
+
+/*** node_slab ***/
+
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::node_slab::reserve(size_t count){
+    if(size_t(m_last-m_next) >= count){
+        return;
+    }
+    m_blocks.emplace_back(new slot[count]);
+    m_next = m_blocks.back().get();
+    m_last = m_next+count;
+}
+
+template<class ValT, class Adjacency>
+template<class Arg>
+auto graph<ValT, Adjacency>::node_slab::create(Arg &&val, size_t id)
+    ->typename graph<ValT, Adjacency>::node*
+{
+    void* place;
+    if(!m_free.empty()){
+        place = m_free.back();
+        m_free.pop_back();
+    }else{
+        if(m_next == m_last){
+            reserve(m_block_size);
+            m_block_size *= 2;
+        }
+        place = m_next++;
+    }
+    return new(place) node(std::forward<Arg>(val), id);
+}
+
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::node_slab::destroy(node *n){
+    n->~node();
+    m_free.emplace_back(n);
+}
+
+/*** edge_arena ***/
+
+template<class ValT, class Adjacency>
+size_t graph<ValT, Adjacency>::edge_arena::p_class(size_t capacity){
+    size_t result = 0;
+    while(capacity >>= 1){
+        result++;
+    }
+    return result;
+}
+
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::edge_arena::reserve(size_t count){
+    if(size_t(m_last-m_next) >= count){
+        return;
+    }
+    m_blocks.emplace_back(new edge[count]);
+    m_next = m_blocks.back().get();
+    m_last = m_next+count;
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::edge_arena::allocate(size_t capacity)
+    ->typename graph<ValT, Adjacency>::edge*
+{
+    auto& free = m_free[p_class(capacity)];
+    if(!free.empty()){
+        auto result = free.back();
+        free.pop_back();
+        return result;
+    }
+    return allocate_exact(capacity);
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::edge_arena::allocate_exact(size_t capacity)
+    ->typename graph<ValT, Adjacency>::edge*
+{
+    if(size_t(m_last-m_next) < capacity){
+        //rest of a block is dropped, blocks double so it is small
+        reserve(std::max(capacity, m_block_size));
+        m_block_size *= 2;
+    }
+    auto result = m_next;
+    m_next += capacity;
+    return result;
+}
+
+template<class ValT, class Adjacency>
+void graph<ValT, Adjacency>::edge_arena::deallocate(edge *edges, size_t capacity){
+    if(edges && capacity){
+        m_free[p_class(capacity)].emplace_back(edges);
+    }
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::bfs(const iterator_base &it)const
+    ->typename graph<ValT, Adjacency>::bfs_iterator
+{
+    return bfs_iterator(it.m_node, m_nodes.size());
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::dfs(const iterator_base &it, dfs_order order)const
+    ->typename graph<ValT, Adjacency>::dfs_iterator
+{
+    return dfs_iterator(it, order, m_nodes.size());
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::end()const
+    ->typename graph<ValT, Adjacency>::iterator_base
+{
+    return iterator_base(nullptr);
+}
+
+template<class ValT, class Adjacency>
+size_t graph<ValT, Adjacency>::size()const{
+    return m_nodes.size();
+}
+
+template<class ValT, class Adjacency>
+size_t graph<ValT, Adjacency>::id(const iterator_base &it){
+    return it.m_node->m_id;
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::at(size_t id)const
+    ->typename graph<ValT, Adjacency>::default_it
+{
+    if(id >= m_nodes.size()){
+        throw std::out_of_range("node id is out of range");
+    }
+    return default_it(m_nodes[id]);
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::freeze()const
+    ->typename graph<ValT, Adjacency>::frozen
+{
+    frozen result;
+    auto& offsets = result.m_offsets;
+    offsets.reserve(m_nodes.size()+1);
+    offsets.emplace_back(0);
+    for(auto node:m_nodes){
+        offsets.emplace_back(offsets.back()+node->m_edges.size());
+    }
+    result.m_targets.reserve(offsets.back());
+    result.m_values.reserve(m_nodes.size());
+    for(auto node:m_nodes){
+        for(auto& edge:node->m_edges){
+            result.m_targets.emplace_back(edge.m_node->m_id);
+        }
+        result.m_values.emplace_back(node->m_value);
+    }
+    return result;
+}
+
+/*** frozen ***/
+
+template<class ValT, class Adjacency>
+size_t graph<ValT, Adjacency>::frozen::size()const{
+    return m_values.size();
+}
+
+template<class ValT, class Adjacency>
+size_t graph<ValT, Adjacency>::frozen::edge_count()const{
+    return m_targets.size();
+}
+
+template<class ValT, class Adjacency>
+size_t graph<ValT, Adjacency>::frozen::degree(size_t id)const{
+    return m_offsets[id+1]-m_offsets[id];
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::frozen::neighbours(size_t id)const
+    ->typename graph<ValT, Adjacency>::frozen::neighbours_range
+{
+    auto targets = m_targets.data();
+    return {targets+m_offsets[id], targets+m_offsets[id+1]};
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::frozen::value(size_t id)const
+    ->const typename graph<ValT, Adjacency>::value_type&
+{
+    return m_values[id];
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::frozen::value(size_t id)
+    ->typename graph<ValT, Adjacency>::value_type&
+{
+    return m_values[id];
+}
+
+template<class ValT, class Adjacency>
+const std::vector<size_t>& graph<ValT, Adjacency>::frozen::offsets()const{
+    return m_offsets;
+}
+
+template<class ValT, class Adjacency>
+const std::vector<size_t>& graph<ValT, Adjacency>::frozen::targets()const{
+    return m_targets;
+}
+
+template<class ValT, class Adjacency>
+auto graph<ValT, Adjacency>::frozen::values()const
+    ->const std::vector<typename graph<ValT, Adjacency>::value_type>&
+{
+    return m_values;
+}
+
+template<class ValT, class Adjacency>
+template<class Fn>
+void graph<ValT, Adjacency>::frozen::bfs(size_t source, Fn fn)const{
+    std::vector<size_t> queue;
+    queue.reserve(size());
+    visited_set visited;
+    visited.reserve(size());
+    queue.emplace_back(source);
+    visited.insert(source);
+    for(size_t head = 0; head < queue.size(); head++){
+        auto id = queue[head];
+        fn(id);
+        for(auto other:neighbours(id)){
+            if(visited.insert(other)){
+                queue.emplace_back(other);
+            }
+        }
+    }
+}
+
+template<class ValT, class Adjacency>
+template<class Fn>
+void graph<ValT, Adjacency>::frozen::dfs(size_t source, Fn fn, dfs_order order)const{
+    //frame is a node and position of its next neighbour
+    std::vector<std::pair<size_t, size_t>> stack;
+    visited_set visited;
+    visited.reserve(size());
+    stack.push_back({source, m_offsets[source]});
+    visited.insert(source);
+    if(order == dfs_order::preorder){
+        fn(source);
+    }
+    while(!stack.empty()){
+        auto& top = stack.back();
+        if(top.second == m_offsets[top.first+1]){
+            auto done = top.first;
+            stack.pop_back();
+            if(order == dfs_order::postorder){
+                fn(done);
+            }
+            continue;
+        }
+        auto other = m_targets[top.second++];
+        if(visited.insert(other)){
+            stack.push_back({other, m_offsets[other]});
+            if(order == dfs_order::preorder){
+                fn(other);
+            }
+        }
+    }
+}
+
+template<class ValT, class Adjacency>
+bfs_result graph<ValT, Adjacency>::frozen::parallel_bfs(size_t source, size_t threads)const{
+    return p_parallel_bfs(size(), edge_count(), source, threads,
+        [this](size_t id){ return degree(id); },
+        [this](size_t id, auto fn){
+            for(auto other:neighbours(id)){
+                if(fn(other)){
+                    return;
+                }
+            }
+        });
+}
+
+template<class ValT, class Adjacency>
+bfs_result graph<ValT, Adjacency>::parallel_bfs(const iterator_base &source, size_t threads)const{
+    size_t edge_ends = 0;
+    for(auto node:m_nodes){
+        edge_ends += node->m_edges.size();
+    }
+    return p_parallel_bfs(m_nodes.size(), edge_ends, source.m_node->m_id, threads,
+        [this](size_t id){ return m_nodes[id]->m_edges.size(); },
+        [this](size_t id, auto fn){
+            for(auto& edge:m_nodes[id]->m_edges){
+                if(fn(edge.m_node->m_id)){
+                    return;
+                }
+            }
+        });
+}
+
+template<class ValT, class Adjacency>
+template<class Fn>
+void graph<ValT, Adjacency>::p_parallel_for(size_t count, size_t threads, Fn fn, size_t grain){
+    const size_t chunk = std::max<size_t>(grain, count/(threads*8));
+    if(threads < 2 || count <= chunk){
+        fn(size_t(0), count, size_t(0));
+        return;
+    }
+    std::atomic<size_t> next(0);
+    auto worker = [&](size_t worker_idx){
+        for(auto i = next.fetch_add(chunk); i < count; i = next.fetch_add(chunk)){
+            fn(i, std::min(count, i+chunk), worker_idx);
+        }
+    };
+    std::vector<std::thread> workers;
+    for(size_t i = 1; i < threads; i++){
+        workers.emplace_back(worker, i);
+    }
+    worker(0);
+    for(auto &w:workers){
+        w.join();
+    }
+}
+
+template<class ValT, class Adjacency>
+std::vector<size_t> graph<ValT, Adjacency>::frozen::connected_components(size_t threads)const{
+    return p_connected_components(size(), threads, [this](size_t id, auto fn){
+        for(auto other:neighbours(id)){
+            fn(other);
+        }
+    });
+}
+
+template<class ValT, class Adjacency>
+std::vector<size_t> graph<ValT, Adjacency>::connected_components(size_t threads)const{
+    return p_connected_components(m_nodes.size(), threads, [this](size_t id, auto fn){
+        for(auto& edge:m_nodes[id]->m_edges){
+            fn(edge.m_node->m_id);
+        }
+    });
+}
+
+template<class ValT, class Adjacency>
+template<class Neighbours>
+std::vector<size_t> graph<ValT, Adjacency>::p_connected_components(size_t count, size_t threads,
+    Neighbours neighbours)
+{
+    threads = p_threads(threads);
+    std::vector<std::atomic<size_t>> parent(count);
+    p_parallel_for(count, threads, [&](size_t first, size_t last, size_t){
+        for(auto id = first; id < last; id++){
+            parent[id].store(id, std::memory_order_relaxed);
+        }
+    });
+    //path halving, parents only decrease, so a concurrent link is never lost
+    auto find = [&parent](size_t id){
+        for(;;){
+            auto up = parent[id].load(std::memory_order_acquire);
+            if(up == id){
+                return id;
+            }
+            auto next = parent[up].load(std::memory_order_acquire);
+            if(up != next){
+                parent[id].compare_exchange_weak(up, next, std::memory_order_acq_rel);
+            }
+            id = next;
+        }
+    };
+    p_parallel_for(count, threads, [&](size_t first, size_t last, size_t){
+        for(auto id = first; id < last; id++){
+            neighbours(id, [&](size_t other){
+                //every edge is seen from both ends, unite it once
+                if(other <= id){
+                    return;
+                }
+                for(auto one = id, two = other;;){
+                    one = find(one);
+                    two = find(two);
+                    if(one == two){
+                        return;
+                    }
+                    if(one < two){
+                        std::swap(one, two);
+                    }
+                    //larger root goes under a smaller one, fails if it is not a root anymore
+                    auto expected = one;
+                    if(parent[one].compare_exchange_strong(expected, two, std::memory_order_acq_rel)){
+                        return;
+                    }
+                }
+            });
+        }
+    });
+    std::vector<size_t> labels(count);
+    p_parallel_for(count, threads, [&](size_t first, size_t last, size_t){
+        for(auto id = first; id < last; id++){
+            labels[id] = find(id);
+        }
+    });
+    //root is the smallest id of a component, so it is labeled before other nodes
+    size_t next_label = 0;
+    for(size_t id = 0; id < count; id++){
+        labels[id] = (labels[id] == id)? next_label++ : labels[labels[id]];
+    }
+    return labels;
+}
+
+template<class ValT, class Adjacency>
+size_t graph<ValT, Adjacency>::p_threads(size_t threads){
+    return threads? threads : std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+template<class ValT, class Adjacency>
+template<class Degree, class Neighbours>
+bfs_result graph<ValT, Adjacency>::p_parallel_bfs(size_t count, size_t edge_ends, size_t source,
+    size_t threads, Degree degree, Neighbours neighbours)
+{
+    //bottom-up when frontier has more than 1/alpha of unexplored edges,
+    //top-down when frontier has less than 1/beta of nodes
+    const size_t alpha = 14, beta = 24;
+    if(source >= count){
+        throw std::out_of_range("source is not in a graph");
+    }
+    threads = p_threads(threads);
+    bfs_result result;
+    auto& distance = result.m_distance;
+    auto& parent = result.m_parent;
+    distance.assign(count, bfs_result::npos);
+    parent.assign(count, bfs_result::npos);
+    const size_t words = (count+63)/64;
+    std::vector<std::atomic<std::uint64_t>> visited(words);
+    auto claim = [&visited](size_t id){
+        auto bit = std::uint64_t(1) << (id%64);
+        return !(visited[id/64].fetch_or(bit, std::memory_order_relaxed) & bit);
+    };
+    std::vector<std::uint64_t> in_frontier;
+    std::vector<std::vector<size_t>> next(threads);
+    std::vector<size_t> frontier = {source};
+    claim(source);
+    distance[source] = 0;
+    parent[source] = source;
+    size_t unexplored_edges = edge_ends-degree(source);
+    bool bottom_up = false;
+    for(size_t level = 1; !frontier.empty(); level++){
+        size_t frontier_edges = 0;
+        for(auto id:frontier){
+            frontier_edges += degree(id);
+        }
+        bottom_up = frontier.size() >= count/beta
+            && (bottom_up || frontier_edges > unexplored_edges/alpha);
+        for(auto& out:next){
+            out.clear();
+        }
+        if(!bottom_up){
+            p_parallel_for(frontier.size(), threads, [&](size_t first, size_t last, size_t worker){
+                auto& out = next[worker];
+                for(auto i = first; i < last; i++){
+                    auto from = frontier[i];
+                    neighbours(from, [&](size_t id){
+                        if(claim(id)){
+                            distance[id] = level;
+                            parent[id] = from;
+                            out.emplace_back(id);
+                        }
+                        return false;
+                    });
+                }
+            });
+        }else{
+            in_frontier.assign(words, 0);
+            for(auto id:frontier){
+                in_frontier[id/64] |= std::uint64_t(1) << (id%64);
+            }
+            p_parallel_for(count, threads, [&](size_t first, size_t last, size_t worker){
+                auto& out = next[worker];
+                for(auto id = first; id < last; id++){
+                    if(visited[id/64].load(std::memory_order_relaxed) >> (id%64) & 1){
+                        continue;
+                    }
+                    neighbours(id, [&](size_t from){
+                        if(!(in_frontier[from/64] >> (from%64) & 1)){
+                            return false;
+                        }
+                        claim(id);
+                        distance[id] = level;
+                        parent[id] = from;
+                        out.emplace_back(id);
+                        return true;
+                    });
+                }
+            });
+        }
+        frontier.clear();
+        for(auto& out:next){
+            frontier.insert(frontier.end(), out.begin(), out.end());
+        }
+        for(auto id:frontier){
+            unexplored_edges -= degree(id);
+        }
+    }
+    return result;
+}
+
+template<class ValT, class Adjacency>
+template<class NodeIt>
+auto graph<ValT, Adjacency>::get_adjacent(NodeIt node_it)
+    ->typename graph<ValT, Adjacency>::template adjacent_range<NodeIt>
+{
+    const auto& edges = node_it.m_node->m_edges;
+    return adjacent_range<NodeIt>(edges.begin(), edges.end());
+}
+
+template<class ValT, class Adjacency>
 template<class NodeIt>
-auto graph<ValT>::is_adjacent(NodeIt node_one_it, NodeIt node_two_it)
+auto graph<ValT, Adjacency>::is_adjacent(NodeIt node_one_it, NodeIt node_two_it)
     ->bool
 {
-    auto& edges_one = node_one_it.m_node->m_edges;
-    auto& edges_two = node_two_it.m_node->m_edges;
-    return std::find_first_of(edges_one.begin(), edges_one.end(),
-        edges_two.begin(), edges_two.end()) != edges_one.end();
+    return find_edge(node_one_it, node_two_it) != nullptr;
+}
+
+template<class ValT, class Adjacency>
+template<class NodeIt>
+auto graph<ValT, Adjacency>::find_edge(NodeIt node_one_it, NodeIt node_two_it)
+    ->const typename graph<ValT, Adjacency>::edge*
+{
+    const node* one = node_one_it.m_node;
+    const node* two = node_two_it.m_node;
+    if(one->m_edges.size() <= two->m_edges.size()){
+        return Adjacency::find(one, two);
+    }
+    //reverse end of a found one is in edges of node_one_it
+    auto found = Adjacency::find(two, one);
+    return found? &one->m_edges[found->m_back] : nullptr;
+}
+
+/**
+ * Level-synchronous breadth-first search on many threads
+ * @param gr graph or its frozen snapshot
+ * @param source start node: iterator for a graph, id for a snapshot
+ * @param threads number of threads, all cores if 0
+ * @return distances and parents by node ids
+ */
+template<class Graph, class Source>
+bfs_result parallel_bfs(const Graph &gr, const Source &source, size_t threads=0){
+    return gr.parallel_bfs(source, threads);
 }
 
-};
\ No newline at end of file
+/**
+ * Labels of connected components on many threads
+ * @param gr graph or its frozen snapshot
+ * @param threads number of threads, all cores if 0
+ * @return dense labels by node ids, numbered in order of smallest ids of components
+ */
+template<class Graph>
+std::vector<size_t> connected_components(const Graph &gr, size_t threads=0){
+    return gr.connected_components(threads);
+}
+
+};
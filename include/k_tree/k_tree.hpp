@@ -23,10 +23,25 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 ***/
 #include <iterator>
+#include <algorithm>
+#include <new>
 #include <deque>
 #include <cassert>
 #include <queue>
 #include <functional>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <cstddef>
+#include <mutex>
+#include <type_traits>
+#include <stdexcept>
+#if __cplusplus >= 202002L && __has_include(<ranges>)
+#include <ranges>
+#endif
 
 namespace k_tree{
 
@@ -83,22 +98,1157 @@ static inline bool is_left_to(const It &lhs, const It &rhs);
  */
 template<class It>
 static inline bool is_right_to(const It &lhs, const It &rhs);
+/**
+ * Mixes bits of a hash, splitmix64 finalizer
+ * @param x hash to mix
+ * @return mixed hash
+ */
+static inline std::uint64_t hash_mix(std::uint64_t x);
+};
+
+template<class T, class... Policies>
+class tree;
+
+namespace policy{
+/**
+ * Base of tree policies
+ * A policy adds data to every node and methods to a tree,
+ * and is notified about changes of a tree through static hooks.
+ * Policies derive from base<Self> and hide what they need,
+ * everything else does nothing.
+ */
+template<class Derived>
+struct base{
+    /**
+     * Data added to every node, node derives from it
+     */
+    template<class Node>
+    struct node_data{};
+    /**
+     * Methods added to a tree, tree derives from it
+     */
+    template<class Tree>
+    class extension{};
+    /**
+     * Called after a chain of siblings was linked into a tree.
+     * Values and subtrees of a chain are complete.
+     * @param t tree of a chain
+     * @param first first node of a chain
+     * @param last last node of a chain
+     */
+    template<class Tree, class Node>
+    static void on_link(Tree&, Node*, Node*){}
+    /**
+     * Called before a node with its subtree is unlinked from a tree.
+     * @param t tree of a node
+     * @param n node to unlink, links are still intact
+     */
+    template<class Tree, class Node>
+    static void on_unlink(Tree&, Node*){}
+    /**
+     * Called after value of a node was changed through a tree.
+     * @param t tree of a node
+     * @param n changed node
+     */
+    template<class Tree, class Node>
+    static void on_modify(Tree&, Node*){}
+    /**
+     * Called when a value is given out through a mutable iterator or view,
+     * so it may be written without a tree knowing it.
+     * @param n node of a value, foot if all values are given out
+     */
+    template<class Node>
+    static void on_access(Node*){}
+    /**
+     * Called after children of a node were reordered.
+     * @param t tree of a node
+     * @param parent node which children were reordered
+     */
+    template<class Tree, class Node>
+    static void on_reorder(Tree&, Node*){}
+    /**
+     * Called after a subtree was rebuilt, e.g. copied or sorted.
+     * @param t tree of a node
+     * @param n root of a sorted subtree, nullptr for a whole rebuilt tree
+     */
+    template<class Tree, class Node>
+    static void on_rebuild(Tree&, Node*){}
+    /**
+     * Called before a node is returned to the pool.
+     * Node data of policies is moved when nodes are relocated,
+     * moved-from data is destroyed this way too.
+     * @param t tree of a node
+     * @param n node to destroy, links may be stale
+     */
+    template<class Tree, class Node>
+    static void on_destroy(Tree&, Node*){}
+    /**
+     * Quick check before full comparison of trees
+     * @return "false" if trees are surely different, "true" otherwise
+     */
+    template<class Tree>
+    static bool may_equal(const Tree&, const Tree&){
+        return true;
+    }
+};
+
+/**
+ * Hash functor that forwards to std::hash of an argument type
+ */
+struct std_hash{
+    template<class X>
+    size_t operator()(const X &x)const{
+        return std::hash<X>()(x);
+    }
+};
+
+/**
+ * Merkle hashing policy
+ * Keeps hash of value and structure of every subtree.
+ * Hash of a node mixes hash of its value with a sum over adjacent pairs
+ * of its children, so any change updates each ancestor in O(1).
+ * Trees with different hashes are never equal, so operator== rejects
+ * them without a walk; equal hashes still need full comparison.
+ * Values given out by mutable iterators may be written, so their nodes
+ * and ancestors become stale and are rehashed on a next query;
+ * read through const iterators or a const tree to keep hashes fresh.
+ * hash() also checks every top level node, so it is O(1) only for
+ * a tree with one root.
+ * @tparam Hash hash functor of values
+ */
+template<class Hash = std_hash>
+struct merkle: base<merkle<Hash>>{
+    using hash_type = std::uint64_t;
+
+    template<class Node>
+    struct node_data{
+        hash_type value_hash = 0; /**< Hash of a node value */
+        hash_type children_hash = merkle::p_pair(merkle::seed, merkle::seed); /**< Sum over children pairs */
+        bool stale = false; /**< Node or a descendant may be written through an iterator */
+    };
+
+    template<class Tree>
+    class extension{
+    public:
+        /**
+         * Fingerprint of a whole tree
+         * @return hash of values and structure of a tree
+         */
+        hash_type hash()const{
+            merkle::p_refresh_tree(p_self());
+            return merkle::p_mix(p_self().end().n->children_hash);
+        }
+        /**
+         * Hash of a subtree
+         * @param it iterator to root of a subtree
+         * @return hash of values and structure of a subtree
+         */
+        template<class It>
+        hash_type subtree_hash(const It &it)const{
+            if(it.n->stale){
+                merkle::p_refresh_stale(it.n);
+            }
+            return merkle::p_hash(it.n);
+        }
+        /**
+         * Index of all subtrees by their hash
+         * Identical subtrees share a bucket; colliding ones may too,
+         * check candidates with equal_subtrees.
+         * @return multimap from subtree hash to iterator
+         */
+        auto subtree_index()const{
+            std::unordered_multimap<hash_type, typename Tree::iterator> result;
+            merkle::p_refresh_tree(p_self());
+            for(auto it = p_self().begin(); it != p_self().end(); it++){
+                result.emplace(merkle::p_hash(it.n), it);
+            }
+            return result;
+        }
+        /**
+         * Compares two subtrees, rejects by hash first
+         * @param lhs iterator to root of first subtree
+         * @param rhs iterator to root of second subtree
+         * @return "true" if values and structure are equal
+         */
+        template<class It>
+        static bool equal_subtrees(const It &lhs, const It &rhs){
+            for(auto n:{lhs.n, rhs.n}){
+                if(n->stale){
+                    merkle::p_refresh_stale(n);
+                }
+            }
+            if(merkle::p_hash(lhs.n) != merkle::p_hash(rhs.n)){
+                return false;
+            }
+            auto l = lhs.n, r = rhs.n;
+            while(true){
+                if(!(l->value() == r->value()) ||
+                    !l->child_begin != !r->child_begin)
+                {
+                    return false;
+                }
+                if(l->child_begin){
+                    l = l->child_begin;
+                    r = r->child_begin;
+                    continue;
+                }
+                while(l != lhs.n && !l->right){
+                    if(r->right){
+                        return false;
+                    }
+                    l = l->parent;
+                    r = r->parent;
+                }
+                if(l == lhs.n){
+                    return true;
+                }
+                if(!r->right){
+                    return false;
+                }
+                l = l->right;
+                r = r->right;
+            }
+        }
+    private:
+        const Tree& p_self()const{
+            return static_cast<const Tree&>(*this);
+        }
+    };
+
+    template<class Tree, class Node>
+    static void on_link(Tree &t, Node* first, Node* last){
+        for(auto n = first; n != last->right; n = n->right){
+            n->value_hash = Hash()(n->value());
+        }
+        auto holder = p_holder(t, first);
+        auto old = p_hash(holder);
+        auto l = p_sibling(first->left), r = p_sibling(last->right);
+        holder->children_hash -= p_pair(l, r);
+        for(auto n = first; n != last->right; n = n->right){
+            auto h = p_hash(n);
+            holder->children_hash += p_pair(l, h);
+            l = h;
+        }
+        holder->children_hash += p_pair(l, r);
+        p_propagate(t, holder, old);
+        //stale subtree moved under a fresh node, top level is checked by hash()
+        for(auto n = first; n != last->right; n = n->right){
+            if(n->stale && n->parent){
+                on_access(n->parent);
+                break;
+            }
+        }
+    }
+
+    template<class Tree, class Node>
+    static void on_unlink(Tree &t, Node* n){
+        if(n->stale && !n->parent){
+            //stale hash leaves a sum of top level, which is rebuilt then
+            t.end().n->stale = true;
+        }
+        auto holder = p_holder(t, n);
+        auto old = p_hash(holder);
+        auto l = p_sibling(n->left), r = p_sibling(n->right), h = p_hash(n);
+        holder->children_hash += p_pair(l, r) - p_pair(l, h) - p_pair(h, r);
+        p_propagate(t, holder, old);
+    }
+
+    template<class Tree, class Node>
+    static void on_modify(Tree &t, Node* n){
+        auto old = p_hash(n);
+        n->value_hash = Hash()(n->value());
+        p_propagate(t, n, old);
+    }
+
+    template<class Node>
+    static void on_access(Node* n){
+        //writers of distinct values may run in parallel, so flags are shared
+        for(; n && !p_load_stale(n); n = n->parent){
+            p_store_stale(n);
+        }
+    }
+
+    template<class Tree, class Node>
+    static void on_reorder(Tree &t, Node* parent){
+        auto old = p_hash(parent);
+        parent->children_hash = p_fold(parent->child_begin);
+        p_propagate(t, parent, old);
+    }
+
+    template<class Tree, class Node>
+    static void on_rebuild(Tree &t, Node* n){
+        if(n){
+            auto old = p_hash(n);
+            p_refresh(n);
+            p_propagate(t, n, old);
+            return;
+        }
+        p_refresh_all(t);
+    }
+
+    template<class Tree>
+    static bool may_equal(const Tree &lhs, const Tree &rhs){
+        return lhs.hash() == rhs.hash();
+    }
+private:
+    static constexpr hash_type seed = 0x9e3779b97f4a7c15ull; /**< Hash of missing sibling */
+    static hash_type p_mix(hash_type x){
+        return algo::hash_mix(x);
+    }
+    /**
+     * Order-dependent hash of two adjacent siblings
+     */
+    static hash_type p_pair(hash_type lhs, hash_type rhs){
+        return p_mix(lhs * 0xff51afd7ed558ccdull + rhs);
+    }
+
+    template<class Node>
+    static hash_type p_hash(const Node* n){
+        return p_mix(n->value_hash ^ p_mix(n->children_hash + seed));
+    }
+    /**
+     * Hash of a neighbour, seed for missing one or foot
+     */
+    template<class Node>
+    static hash_type p_sibling(const Node* n){
+        return (!n || (!n->parent && !n->right))? seed : p_hash(n);
+    }
+    /**
+     * Node that holds sum over siblings of n, foot for top level
+     */
+    template<class Tree, class Node>
+    static Node* p_holder(Tree &t, Node* n){
+        return n->parent? n->parent : t.end().n;
+    }
+    /**
+     * Sum over adjacent pairs of a sibling chain, stops at foot
+     */
+    template<class Node>
+    static hash_type p_fold(Node* first){
+        hash_type result = 0, l = seed;
+        for(auto n = first; n && (n->parent || n->right); n = n->right){
+            auto h = p_hash(n);
+            result += p_pair(l, h);
+            l = h;
+        }
+        return result + p_pair(l, seed);
+    }
+    /**
+     * Recomputes hashes of a subtree bottom-up, without recursion
+     */
+    template<class Node>
+    static void p_refresh(Node* top){
+        auto n = top;
+        while(n->child_begin){
+            n = n->child_begin;
+        }
+        while(true){
+            n->value_hash = Hash()(n->value());
+            n->children_hash = p_fold(n->child_begin);
+            n->stale = false;
+            if(n == top){
+                return;
+            }
+            if(n->right){
+                n = n->right;
+                while(n->child_begin){
+                    n = n->child_begin;
+                }
+            }else{
+                n = n->parent;
+            }
+        }
+    }
+    /**
+     * Relaxed atomic access to a stale flag set by concurrent writers
+     */
+    template<class Node>
+    static bool p_load_stale(Node* n){
+#if defined(__cpp_lib_atomic_ref)
+        return std::atomic_ref<bool>(n->stale).load(std::memory_order_relaxed);
+#else
+        return __atomic_load_n(&n->stale, __ATOMIC_RELAXED);
+#endif
+    }
+    template<class Node>
+    static void p_store_stale(Node* n){
+#if defined(__cpp_lib_atomic_ref)
+        std::atomic_ref<bool>(n->stale).store(true, std::memory_order_relaxed);
+#else
+        __atomic_store_n(&n->stale, true, __ATOMIC_RELAXED);
+#endif
+    }
+    /**
+     * Recomputes hashes of stale nodes of a subtree bottom-up,
+     * fresh subtrees are skipped
+     */
+    template<class Node>
+    static void p_refresh_stale(Node* top){
+        auto first_stale = [](Node* n){
+            while(n && !n->stale){
+                n = n->right;
+            }
+            return n;
+        };
+        for(auto n = top;;){
+            while(auto c = first_stale(n->child_begin)){
+                n = c;
+            }
+            n->value_hash = Hash()(n->value());
+            n->children_hash = p_fold(n->child_begin);
+            n->stale = false;
+            if(n == top){
+                return;
+            }
+            auto next = first_stale(n->right);
+            n = next? next : n->parent;
+        }
+    }
+    /**
+     * Recomputes hashes of a whole tree
+     */
+    template<class Tree>
+    static void p_refresh_all(const Tree &t){
+        auto top = t.begin().n, foot = t.end().n;
+        for(auto n = top; n != foot; n = n->right){
+            p_refresh(n);
+        }
+        foot->children_hash = p_fold(top);
+        foot->stale = false;
+    }
+    /**
+     * Recomputes stale hashes of a tree, foot is stale if all are
+     */
+    template<class Tree>
+    static void p_refresh_tree(const Tree &t){
+        auto top = t.begin().n, foot = t.end().n;
+        if(foot->stale){
+            p_refresh_all(t);
+            return;
+        }
+        bool changed = false;
+        for(auto n = top; n != foot; n = n->right){
+            if(n->stale){
+                p_refresh_stale(n);
+                changed = true;
+            }
+        }
+        if(changed){
+            foot->children_hash = p_fold(top);
+        }
+    }
+    /**
+     * Replaces old hash of n with current one in its ancestors
+     */
+    template<class Tree, class Node>
+    static void p_propagate(Tree &t, Node* n, hash_type old){
+        while(n->parent || n->right){ //stop at foot
+            auto now = p_hash(n);
+            if(now == old){
+                return;
+            }
+            auto holder = p_holder(t, n);
+            auto holder_old = p_hash(holder);
+            auto l = p_sibling(n->left), r = p_sibling(n->right);
+            holder->children_hash += p_pair(l, now) + p_pair(now, r)
+                - p_pair(l, old) - p_pair(old, r);
+            n = holder;
+            old = holder_old;
+        }
+    }
+};
+
+/**
+ * Depth caching policy
+ * Keeps distance from a top level in every node, so depth is O(1)
+ * and a path from a top level is extracted in one pass.
+ * Links of a subtree moved to another depth are updated in O(subtree).
+ */
+struct cached_depth: base<cached_depth>{
+    template<class Node>
+    struct node_data{
+        size_t depth = 0; /**< Distance from a top level */
+    };
+
+    template<class Tree>
+    class extension{
+    public:
+        /**
+         * Depth of a node
+         * @param it iterator to a node
+         * @return zero for a top level node, depth of a parent + 1 otherwise
+         */
+        template<class It>
+        size_t depth(const It &it)const{
+            return it.n->depth;
+        }
+        /**
+         * Writes path from a top level to a node, both included
+         * Buffer must have space for depth(it) + 1 iterators.
+         * @param it iterator to a last node of a path
+         * @param out begin of a buffer
+         * @return end of written path
+         */
+        template<class It, class RandomIt>
+        RandomIt path_from_root(const It &it, RandomIt out)const{
+            auto end = out + (it.n->depth + 1);
+            auto pos = end;
+            for(auto n = it.n; n; n = n->parent){
+                *--pos = It(n);
+            }
+            return end;
+        }
+    };
+
+    template<class Tree, class Node>
+    static void on_link(Tree&, Node* first, Node* last){
+        size_t depth = first->parent? first->parent->depth + 1 : 0;
+        for(auto n = first; n != last->right; n = n->right){
+            if(n->depth != depth){
+                p_refresh(n, depth);
+            }
+        }
+    }
+
+    template<class Tree, class Node>
+    static void on_rebuild(Tree &t, Node* n){
+        if(n){
+            p_refresh(n, n->parent? n->parent->depth + 1 : 0);
+            return;
+        }
+        for(n = t.begin().n; n != t.end().n; n = n->right){
+            p_refresh(n, 0);
+        }
+    }
+private:
+    /**
+     * Sets depths of a subtree, without recursion
+     */
+    template<class Node>
+    static void p_refresh(Node* top, size_t depth){
+        top->depth = depth;
+        for(auto n = top->child_begin; n;){
+            n->depth = n->parent->depth + 1;
+            if(n->child_begin){
+                n = n->child_begin;
+                continue;
+            }
+            while(n != top && !n->right){
+                n = n->parent;
+            }
+            n = (n == top)? nullptr : n->right;
+        }
+    }
+};
+
+/**
+ * Functor that returns its argument
+ */
+struct identity{
+    template<class X>
+    const X& operator()(const X &x)const{
+        return x;
+    }
+};
+
+/**
+ * Keyed children policy
+ * Keeps a hash index of children by key in every node with many children,
+ * and of top level nodes in foot, so a child is found in O(1)
+ * and a path of keys is resolved in one call, like in a trie.
+ * Nodes with fewer children are scanned, they need no allocation.
+ * Keys should be unique among siblings, otherwise any of nodes
+ * with an equal key is found.
+ * Values must be changed through tree::replace or tree::modify,
+ * writes through iterators are not tracked.
+ * @tparam Key type of a key
+ * @tparam KeyOf functor that gives key of a value
+ * @tparam Hash hash functor of keys
+ * @tparam Threshold number of children from which a node keeps an index
+ */
+template<class Key, class KeyOf = identity, class Hash = std::hash<Key>, size_t Threshold = 16>
+struct keyed: base<keyed<Key, KeyOf, Hash, Threshold>>{
+    template<class Node>
+    struct node_data{
+        using index_type = std::unordered_multimap<Key, Node*, Hash>;
+        Key key{}; /**< Key of a node value when it was indexed */
+        size_t children = 0; /**< Number of children, of top level nodes in foot */
+        std::unique_ptr<index_type> children_index; /**< Index of children, nullptr below Threshold */
+    };
+
+    template<class Tree>
+    class extension{
+    public:
+        /**
+         * Finds a child by key
+         * @param it iterator to a parent
+         * @param key key of a child
+         * @return iterator to a child, end() if there is none
+         */
+        template<class It>
+        It find_child(const It &it, const Key &key)const{
+            return It(keyed::p_find(it.n, key, p_self().end().n));
+        }
+        /**
+         * Finds a node by keys of a path from a top level
+         * @param keys keys of nodes of a path, first is at top level
+         * @return iterator to the last node of a path, end() if there is
+         * none or a path is empty
+         */
+        template<class... Keys>
+        auto find_path(const Keys&... keys)const{
+            if constexpr(sizeof...(Keys) == 0){
+                const Key* path = nullptr;
+                return find_path(path, path);
+            }else{
+                const Key path[] = {Key(keys)...};
+                return find_path(std::begin(path), std::end(path));
+            }
+        }
+        /**
+         * Finds a node by keys of a path from a top level
+         * @param first begin of a range of keys, first is at top level
+         * @param last end of a range of keys
+         * @return iterator to the last node of a path, end() if there is
+         * none or a range is empty
+         */
+        template<class InputIt, class = std::enable_if_t<std::is_convertible<
+            typename std::iterator_traits<InputIt>::value_type, Key>::value>>
+        auto find_path(InputIt first, InputIt last)const{
+            using iterator = typename Tree::iterator;
+            auto foot = p_self().end().n;
+            decltype(foot) n = foot;
+            for(; first != last; ++first){
+                n = keyed::p_find(n == foot? nullptr : n, *first, foot);
+                if(n == foot){
+                    return iterator(foot);
+                }
+            }
+            return iterator(n);
+        }
+    private:
+        const Tree& p_self()const{
+            return static_cast<const Tree&>(*this);
+        }
+    };
+
+    template<class Tree, class Node>
+    static void on_link(Tree &t, Node* first, Node* last){
+        auto holder = p_holder(t, first);
+        for(auto n = first; n != last->right; n = n->right){
+            n->key = KeyOf()(n->value());
+            p_insert(holder, n);
+        }
+        p_grow(holder, first);
+    }
+
+    template<class Tree, class Node>
+    static void on_unlink(Tree &t, Node* n){
+        p_remove(p_holder(t, n), n);
+    }
+
+    template<class Tree, class Node>
+    static void on_modify(Tree &t, Node* n){
+        Key key = KeyOf()(n->value());
+        if(key == n->key){
+            return;
+        }
+        auto holder = p_holder(t, n);
+        p_remove(holder, n);
+        n->key = std::move(key);
+        p_insert(holder, n);
+    }
+
+    template<class Tree, class Node>
+    static void on_rebuild(Tree &t, Node* n){
+        //a sorted subtree has the same children and keys in every node
+        if(n){
+            return;
+        }
+        auto foot = t.end().n;
+        foot->children_index.reset();
+        foot->children = 0;
+        for(n = t.begin().n; n != foot; n = n->right){
+            n->key = KeyOf()(n->value());
+            p_insert(foot, n);
+            p_refresh(n);
+        }
+        if(!t.empty()){
+            p_grow(foot, t.begin().n);
+        }
+    }
+private:
+    /**
+     * Node that holds index of siblings of n, foot for top level
+     */
+    template<class Tree, class Node>
+    static Node* p_holder(Tree &t, Node* n){
+        return n->parent? n->parent : t.end().n;
+    }
+    /**
+     * Finds a child of parent by key, parent is nullptr for top level
+     * @return found child, foot if there is none
+     */
+    template<class Node>
+    static Node* p_find(Node* parent, const Key &key, Node* foot){
+        auto &index = (parent? parent : foot)->children_index;
+        if(index){
+            auto found = index->find(key);
+            return (found == index->end())? foot : found->second;
+        }
+        for(auto n = parent? parent->child_end : foot->left; n; n = n->left){
+            if(n->key == key){
+                return n;
+            }
+        }
+        return foot;
+    }
+    template<class Node>
+    static void p_insert(Node* holder, Node* n){
+        holder->children++;
+        if(holder->children_index){
+            holder->children_index->emplace(n->key, n);
+        }
+    }
+    /**
+     * Indexes all siblings of child once holder has Threshold children
+     */
+    template<class Node>
+    static void p_grow(Node* holder, Node* child){
+        if(holder->children_index || holder->children < Threshold){
+            return;
+        }
+        holder->children_index.reset(new typename node_data<Node>::index_type(holder->children));
+        while(child->left){
+            child = child->left;
+        }
+        //last top level node is followed by foot, which holds their index
+        for(; child && child != holder; child = child->right){
+            holder->children_index->emplace(child->key, child);
+        }
+    }
+    template<class Node>
+    static void p_remove(Node* holder, Node* n){
+        holder->children--;
+        auto &index = holder->children_index;
+        if(!index){
+            return;
+        }
+        //index is kept down to a half of Threshold, so it is not rebuilt back and forth
+        if(holder->children < Threshold / 2){
+            index.reset();
+            return;
+        }
+        auto range = index->equal_range(n->key);
+        for(auto it = range.first; it != range.second; ++it){
+            if(it->second == n){
+                index->erase(it);
+                break;
+            }
+        }
+    }
+    /**
+     * Rebuilds keys and indices of a subtree, without recursion
+     */
+    template<class Node>
+    static void p_refresh(Node* top){
+        for(auto n = top;;){
+            n->children_index.reset();
+            n->children = 0;
+            for(auto c = n->child_begin; c; c = c->right){
+                c->key = KeyOf()(c->value());
+                p_insert(n, c);
+            }
+            if(n->child_begin){
+                p_grow(n, n->child_begin);
+                n = n->child_begin;
+                continue;
+            }
+            while(n != top && !n->right){
+                n = n->parent;
+            }
+            if(n == top){
+                return;
+            }
+            n = n->right;
+        }
+    }
+};
+
+/**
+ * Generational handle of a node
+ * Low SlotBits of a word are index of a slot in a handle table,
+ * other bits are generation of a slot. Zero is a null handle.
+ * @tparam Word unsigned integer type of a handle
+ * @tparam SlotBits number of bits of a slot index
+ */
+template<class Word, unsigned SlotBits>
+class basic_handle{
+    static_assert(std::is_unsigned<Word>::value && SlotBits + 2 <= sizeof(Word) * 8,
+        "handle must be an unsigned word with at least two bits left for generation");
+    Word word = 0; /**< Generation and slot */
+public:
+    static constexpr Word slot_mask = (Word(1) << SlotBits) - 1;
+    static constexpr Word generation_mask = static_cast<Word>(Word(~Word(0)) >> SlotBits);
+    basic_handle() = default;
+    /**
+     * Makes handle from a raw word
+     * @param word word given by value()
+     */
+    explicit basic_handle(Word word)
+        :word(word)
+    {}
+    basic_handle(Word slot, Word generation)
+        :word(static_cast<Word>(generation << SlotBits | slot))
+    {}
+    /**
+     * Raw word of a handle, for storing and hashing
+     */
+    Word value()const{
+        return word;
+    }
+    Word slot()const{
+        return word & slot_mask;
+    }
+    Word generation()const{
+        return word >> SlotBits;
+    }
+    explicit operator bool()const{
+        return word != 0;
+    }
+    bool operator==(const basic_handle &rhs)const{
+        return word == rhs.word;
+    }
+    bool operator!=(const basic_handle &rhs)const{
+        return word != rhs.word;
+    }
+};
+
+/**
+ * Generational handles policy
+ * Gives nodes handles that stay valid while a node lives, across moves
+ * of nodes and subtrees, compact() and moves of a tree, and become stale
+ * when a node is erased. A handle resolves to an iterator in O(1),
+ * stale one is detected with one compare. Handles are given on demand,
+ * nodes without them pay only a slot field.
+ * Slots of erased nodes are reused with a next generation.
+ * Generations of live slots are odd and of free ones even, so a handle
+ * of an erased node never matches until its slot is reused.
+ * @tparam Word unsigned integer type of a handle
+ * @tparam SlotBits number of bits of a slot index, by default half of
+ * a 64-bit word and three quarters of a smaller one, e.g. 24 of 32 bits
+ */
+template<class Word = std::uint64_t, unsigned SlotBits = (sizeof(Word) < 8)? sizeof(Word) * 6 : 32>
+struct handles: base<handles<Word, SlotBits>>{
+    using handle_type = basic_handle<Word, SlotBits>;
+
+    template<class Node>
+    struct node_data{
+        Word handle_slot = 0; /**< Slot index + 1, zero if node has no handle */
+        node_data() = default;
+        node_data(const node_data &rhs) = delete;
+        node_data& operator=(const node_data &rhs) = delete;
+        /**
+         * Takes slot of rhs, so handle follows a relocated node
+         */
+        node_data& operator=(node_data &&rhs){
+            handle_slot = rhs.handle_slot;
+            rhs.handle_slot = 0;
+            return *this;
+        }
+    };
+
+    template<class Tree>
+    class extension{
+        friend struct handles;
+    public:
+        using handle_type = handles::handle_type;
+    private:
+        /**
+         * Slot of a handle table
+         */
+        struct entry{
+            void* n; /**< Node of a slot, nullptr if slot is free */
+            Word generation; /**< Generation of a handle, odd if slot is taken */
+        };
+        std::vector<entry> table; /**< Slots of handles */
+        std::vector<Word> free_slots; /**< Indices of free slots */
+    public:
+        /**
+         * Gives handle of a node, makes it on a first call
+         * @param it iterator to a node
+         * @return handle of a node
+         * @throw std::length_error if all slots are taken by live nodes
+         */
+        template<class It>
+        handle_type handle(const It &it){
+            auto n = it.n;
+            if(!n->handle_slot){
+                Word slot;
+                if(!free_slots.empty()){
+                    slot = free_slots.back();
+                    free_slots.pop_back();
+                    table[slot].n = n;
+                    table[slot].generation++;
+                }else{
+                    if(table.size() > handle_type::slot_mask){
+                        throw std::length_error("handle slots are exhausted");
+                    }
+                    slot = static_cast<Word>(table.size());
+                    table.push_back({n, 1});
+                }
+                n->handle_slot = slot + 1;
+            }
+            auto slot = n->handle_slot - 1;
+            return handle_type(slot, table[slot].generation);
+        }
+        /**
+         * Resolves handle to a node
+         * @param h handle given by handle()
+         * @return iterator to a node, end() if handle is stale or null
+         */
+        auto resolve(handle_type h)const{
+            using iterator = typename Tree::iterator;
+            using node_ptr = decltype(std::declval<iterator>().n);
+            if(!valid(h)){
+                return iterator(p_self().end().n);
+            }
+            return iterator(static_cast<node_ptr>(table[h.slot()].n));
+        }
+        /**
+         * Checks if handle refers to a live node
+         * @param h handle given by handle()
+         * @return "true" if a node of a handle is not erased
+         */
+        bool valid(handle_type h)const{
+            auto slot = h.slot();
+            return slot < table.size() && table[slot].generation == h.generation();
+        }
+    private:
+        const Tree& p_self()const{
+            return static_cast<const Tree&>(*this);
+        }
+    };
+
+    template<class Tree, class Node>
+    static void on_destroy(Tree &t, Node* n){
+        if(!n->handle_slot){
+            return;
+        }
+        auto &ext = static_cast<extension<Tree>&>(t);
+        auto slot = n->handle_slot - 1;
+        auto &e = ext.table[slot];
+        e.n = nullptr;
+        //an even generation matches no handle, zero is skipped as
+        //generation of a null handle
+        e.generation = static_cast<Word>((e.generation + 1) & handle_type::generation_mask);
+        if(!e.generation){
+            e.generation = 2;
+        }
+        ext.free_slots.push_back(slot);
+        n->handle_slot = 0;
+    }
+
+    template<class Tree, class Node>
+    static void on_rebuild(Tree &t, Node* n){
+        //compact() relocates nodes of a whole tree, point slots to them again
+        auto &ext = static_cast<extension<Tree>&>(t);
+        if(n || ext.table.size() == ext.free_slots.size()){
+            return;
+        }
+        auto foot = t.end().n;
+        for(n = t.begin().n; n != foot;){
+            if(n->handle_slot){
+                ext.table[n->handle_slot - 1].n = n;
+            }
+            if(n->child_begin){
+                n = n->child_begin;
+                continue;
+            }
+            while(!n->right){
+                n = n->parent;
+            }
+            n = n->right;
+        }
+    }
+};
+
+/**
+ * Dense array of values with links back to their nodes
+ * Erased slot is filled with the last value, so values stay contiguous.
+ * Nodes keep pointers to their values, pointers are fixed up
+ * when an array grows or a value moves.
+ */
+template<class T>
+class value_store{
+    static_assert(!std::is_same<T, bool>::value,
+        "separate_values needs addressable values, std::vector<bool> packs bools into bits");
+    std::vector<T> dense; /**< Values */
+    std::vector<T**> owners; /**< Value pointer of a node for each value */
+    void p_fixup(){
+        for(size_t i = 0; i < owners.size(); i++){
+            *owners[i] = &dense[i];
+        }
+    }
+public:
+    /**
+     * Preallocates space, so next values don't move others
+     * @param count total number of values
+     */
+    void reserve(size_t count){
+        if(dense.capacity() < count){
+            dense.reserve(count);
+            owners.reserve(count);
+            p_fixup();
+        }
+    }
+    /**
+     * Appends default constructed value
+     * @param owner value pointer of a node, set to a new value
+     */
+    void acquire(T* &owner){
+        auto data = dense.data();
+        dense.emplace_back();
+        owners.emplace_back(&owner);
+        if(dense.data() != data){
+            p_fixup();
+        }else{
+            owner = &dense.back();
+        }
+    }
+    /**
+     * Removes value, the last value takes its slot
+     * @param owner value pointer of a node, set to nullptr
+     */
+    void release(T* &owner){
+        auto i = static_cast<size_t>(owner - dense.data());
+        if(i + 1 != dense.size()){
+            dense[i] = std::move(dense.back());
+            owners[i] = owners.back();
+            *owners[i] = &dense[i];
+        }
+        dense.pop_back();
+        owners.pop_back();
+        owner = nullptr;
+    }
+    /**
+     * Reorders values as given by owners
+     * @param count number of values
+     * @param owner function giving value pointer of i-th node
+     */
+    template<class Owner>
+    void reorder(size_t count, Owner owner){
+        assert(count == dense.size());
+        std::vector<T> result;
+        result.reserve(count);
+        for(size_t i = 0; i < count; i++){
+            T* &ptr = owner(i);
+            result.emplace_back(std::move(*ptr));
+            owners[i] = &ptr;
+        }
+        dense.swap(result);
+        p_fixup();
+    }
+    T* data(){
+        return dense.data();
+    }
+    const T* data()const{
+        return dense.data();
+    }
+    size_t size()const{
+        return dense.size();
+    }
 };
 
-template<class T>
-class tree{
+/**
+ * Separated value storage policy
+ * Values live in one contiguous array owned by a tree,
+ * nodes hold only links and a pointer to their value.
+ * Passes over values only, like normalization or accumulation,
+ * run over values() as a plain array independent of a tree shape.
+ * Order of values() is unspecified: erase moves the last value
+ * into a freed slot, compact() orders values depth-first.
+ * bool values are not supported, as values() needs a plain array;
+ * use char or a struct holding a bool.
+ */
+struct separate_values: base<separate_values>{
+    template<class Tree>
+    class extension;
+};
+
+template<class T, class... Policies>
+class separate_values::extension<tree<T, Policies...>>{
+public:
+    /**
+     * Contiguous array of all values
+     * Valid until a next insert or erase.
+     * @return range of pointers over values
+     */
+    auto values(){
+        using range = typename tree<T, Policies...>::template range<T*>;
+        (Policies::on_access(static_cast<tree<T, Policies...>&>(*this).end().n), ...);
+        return range(p_values.data(), p_values.data() + p_values.size());
+    }
+    /**
+     * Contiguous read-only array of all values
+     * Valid until a next insert or erase.
+     * @return range of pointers over values
+     */
+    auto values()const{
+        using range = typename tree<T, Policies...>::template range<const T*>;
+        return range(p_values.data(), p_values.data() + p_values.size());
+    }
+protected:
+    value_store<T> p_values; /**< Values of all nodes */
+
+};
+};
+
+template<class T, class... Policies>
+class tree: public Policies::template extension<tree<T, Policies...>>...{
+    /**
+     * Values are kept in a dense array instead of nodes
+     */
+    static constexpr bool p_separated =
+        (false || ... || std::is_same<Policies, policy::separate_values>::value);
+    /**
+     * Value of a node kept in a node
+     */
+    struct inline_value{
+        T data; /**< Value */
+        T& value(){
+            return data;
+        }
+        const T& value()const{
+            return data;
+        }
+    };
+    /**
+     * Value of a node kept in a dense array of a tree
+     */
+    struct separate_value{
+        T* ptr = nullptr; /**< Value in a dense array, nullptr for foot */
+        T& value(){
+            return *ptr;
+        }
+        const T& value()const{
+            return *ptr;
+        }
+    };
     /**
      * Node struct for k_tree
      * Contains pointers to parent, left and right neighbours,
-     * begin and end of children
+     * begin and end of children, data of policies and a value
+     * or a pointer to it
      */
-    struct node{
+    struct node: public Policies::template node_data<node>...,
+        public std::conditional_t<p_separated, separate_value, inline_value>
+    {
         node* parent; /**< Parent of a node */
         node* left, /**< Left neighbour of a node */
             * right; /**< Right neighbour of a node */
         node* child_begin, /**< Pointer to childrens begin */
             *child_end; /**< Pointer to childrens end */
-        T value; /**< Templated value of a node */
         /**
          * Default constructor
          * Initializes pointers to other nodes to nullptr
@@ -123,7 +1273,7 @@ public:
         typedef T value_type;
         typedef T& reference;
         typedef T* pointer;
-        typedef size_t difference_type;
+        typedef std::ptrdiff_t difference_type;
         typedef std::forward_iterator_tag iterator_category;
 
         /**
@@ -133,14 +1283,16 @@ public:
         iterator_base(const iterator_base &rhs);
         /**
          * Dereference operator
+         * Constness of an iterator doesn't change access to a value,
+         * use const iterators for read-only access.
          * @return reference of a node value
          */
-        auto& operator*();
+        T& operator*()const;
         /**
-         * Const-dereference operator
-         * @return const-reference of a node value
+         * Member access operator
+         * @return pointer to a node value
          */
-        const auto& operator*()const;
+        T* operator->()const;
         /**
          * Equal operator
          * @param rhs rvalue to compare to
@@ -160,11 +1312,12 @@ public:
      */
     class depth_first_iterator:public iterator_base{
     public:
+        typedef std::bidirectional_iterator_tag iterator_category;
         /**
          * Constructor
          * @param n node for an iterator
          */
-        depth_first_iterator(node* n);
+        depth_first_iterator(node* n = nullptr);
         /**
          * Copy Constructor
          * @param rhs rvalue of a copying
@@ -204,7 +1357,7 @@ public:
          * Constructor
          * @param n node for an iterator
          */
-        depth_first_reverse_iterator(node* n);
+        depth_first_reverse_iterator(node* n = nullptr);
         /**
          * Copy Constructor
          * @param rhs rvalue of a copying
@@ -224,119 +1377,978 @@ public:
          * Prefix decrement operator
          * @return reference to current iterator
          */
-        depth_first_reverse_iterator& operator--();
+        depth_first_reverse_iterator& operator--();
+        /**
+         * Postfix decrement operator
+         * @return copy of current iterator
+         */
+        depth_first_reverse_iterator operator--(int);
+    };
+
+    /**
+     * Breadth-first iterator
+     * Iterates through tree nodes from left to right.
+     * Classic queue approach.
+     */ 
+    class breadth_first_iterator:public iterator_base {
+        node* end = nullptr;
+    public:
+        /**
+         * Constructor
+         * @param n node for an iterator
+         */
+        breadth_first_iterator(node* n = nullptr);
+        /**
+         * Copy Constructor
+         * @param rhs rvalue of a copying
+         */
+        breadth_first_iterator(const iterator_base &rhs);
+        /**
+         * Prefix increment operator
+         * @return reference to current iterator
+         */
+        breadth_first_iterator& operator++();
+        /**
+         * Postfix increment operator
+         * @return copy of current iterator
+         */
+        breadth_first_iterator operator++(int);
+        /**
+         * Prefix decrement operator
+         * @return reference to current iterator
+         */
+        breadth_first_iterator& operator--() = delete; //not impl
+        /**
+         * Postfix decrement operator
+         * @return copy of current iterator
+         */
+        breadth_first_iterator operator--(int) = delete; //not impl
+    private:
+        std::queue<node *> q;
+    };
+
+    /**
+     * Post-order iterator class
+     * Iterates through node's children recursively from left to right,
+     * then through a node itself. Uses parent links, no stack.
+     */
+    class post_order_iterator:public iterator_base{
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        /**
+         * Constructor
+         * @param n node for an iterator
+         */
+        post_order_iterator(node* n = nullptr);
+        /**
+         * Copy Constructor
+         * @param rhs rvalue of a copying
+         */
+        post_order_iterator(const iterator_base &rhs);
+        /**
+         * Prefix increment operator
+         * @return reference to current iterator
+         */
+        post_order_iterator& operator++();
+        /**
+         * Postfix increment operator
+         * @return copy of current iterator
+         */
+        post_order_iterator operator++(int);
+        /**
+         * Prefix decrement operator
+         * @return reference to current iterator
+         */
+        post_order_iterator& operator--();
+        /**
+         * Postfix decrement operator
+         * @return copy of current iterator
+         */
+        post_order_iterator operator--(int);
+    };
+
+    /**
+     * Leaf iterator class
+     * Iterates through nodes without children from left to right,
+     * skipping others. Amortized O(1) per step, no stack.
+     */
+    class leaf_iterator:public iterator_base{
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        /**
+         * Constructor
+         * @param n node for an iterator
+         */
+        leaf_iterator(node* n = nullptr);
+        /**
+         * Copy Constructor
+         * @param rhs rvalue of a copying
+         */
+        leaf_iterator(const iterator_base &rhs);
+        /**
+         * Prefix increment operator
+         * @return reference to current iterator
+         */
+        leaf_iterator& operator++();
+        /**
+         * Postfix increment operator
+         * @return copy of current iterator
+         */
+        leaf_iterator operator++(int);
+        /**
+         * Prefix decrement operator
+         * @return reference to current iterator
+         */
+        leaf_iterator& operator--();
+        /**
+         * Postfix decrement operator
+         * @return copy of current iterator
+         */
+        leaf_iterator operator--(int);
+    };
+
+    /**
+     * Sibling iterator class
+     * Iterates through neighbours from left to right.
+     * End of children is nullptr, so an iterator remembers a parent
+     * to step back from it.
+     */
+    class sibling_iterator:public iterator_base{
+        node* parent; /**< Parent of siblings, nullptr for top level */
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        /**
+         * Constructor
+         * @param n node for an iterator
+         * @param parent parent of siblings, needed if n is nullptr
+         */
+        sibling_iterator(node* n = nullptr, node* parent = nullptr);
+        /**
+         * Copy Constructor
+         * @param rhs rvalue of a copying
+         */
+        sibling_iterator(const iterator_base &rhs);
+        /**
+         * Prefix increment operator
+         * @return reference to current iterator
+         */
+        sibling_iterator& operator++();
+        /**
+         * Postfix increment operator
+         * @return copy of current iterator
+         */
+        sibling_iterator operator++(int);
+        /**
+         * Prefix decrement operator
+         * @return reference to current iterator
+         */
+        sibling_iterator& operator--();
+        /**
+         * Postfix decrement operator
+         * @return copy of current iterator
+         */
+        sibling_iterator operator--(int);
+    };
+
+    /**
+     * Const iterator class
+     * Traverses a tree like It, but gives read-only access to values.
+     */
+    template<class It>
+    class basic_const_iterator:public It{
+    public:
+        typedef const T& reference;
+        typedef const T* pointer;
+        using It::It;
+        basic_const_iterator() = default;
+        /**
+         * Converting constructor
+         * @param rhs mutable iterator to convert from
+         */
+        basic_const_iterator(const It &rhs)
+            :It(rhs)
+        {}
+        /**
+         * Dereference operator
+         * @return const-reference of a node value
+         */
+        const T& operator*()const{
+            return this->n->value();
+        }
+        /**
+         * Member access operator
+         * @return const-pointer to a node value
+         */
+        const T* operator->()const{
+            return &this->n->value();
+        }
+        basic_const_iterator& operator++(){
+            It::operator++();
+            return *this;
+        }
+        basic_const_iterator operator++(int){
+            auto copy = *this;
+            ++(*this);
+            return copy;
+        }
+        basic_const_iterator& operator--(){
+            It::operator--();
+            return *this;
+        }
+        basic_const_iterator operator--(int){
+            auto copy = *this;
+            --(*this);
+            return copy;
+        }
+    };
+    using const_depth_first_iterator = basic_const_iterator<depth_first_iterator>;
+    using const_depth_first_reverse_iterator = basic_const_iterator<depth_first_reverse_iterator>;
+    using const_breadth_first_iterator = basic_const_iterator<breadth_first_iterator>;
+    using const_post_order_iterator = basic_const_iterator<post_order_iterator>;
+    using const_leaf_iterator = basic_const_iterator<leaf_iterator>;
+    using const_sibling_iterator = basic_const_iterator<sibling_iterator>;
+
+    /**
+     * Pair of iterators usable in range-based for
+     * Models std::ranges::view when ranges are available.
+     */
+    template<class It>
+    class range
+#if defined(__cpp_lib_ranges)
+        :public std::ranges::view_base
+#endif
+    {
+        It first, /**< Begin of a range */
+            last; /**< End of a range */
+    public:
+        range() = default;
+        /**
+         * Constructor
+         * @param first begin of a range
+         * @param last end of a range
+         */
+        range(It first, It last)
+            :first(first), last(last)
+        {}
+        It begin()const{
+            return first;
+        }
+        It end()const{
+            return last;
+        }
+    };
+
+    /**
+     * Random-access range of values in depth-first order
+     * Holds pointers to nodes, so it is valid until structure of a tree
+     * changes. Values may be changed through it unless V is const.
+     * Suitable for parallel algorithms, which need random-access
+     * iterators to split work.
+     * @tparam V T or const T
+     */
+    template<class V>
+    class basic_frozen_range{
+        std::vector<node*> nodes; /**< Nodes in depth-first order */
+    public:
+        /**
+         * Random-access iterator of a frozen range
+         */
+        class iterator{
+            node* const* p; /**< Current node in nodes */
+        public:
+            typedef T value_type;
+            typedef V& reference;
+            typedef V* pointer;
+            typedef std::ptrdiff_t difference_type;
+            typedef std::random_access_iterator_tag iterator_category;
+
+            iterator(node* const* p = nullptr)
+                :p(p)
+            {}
+            V& operator*()const{
+                return p_value(*p);
+            }
+            V* operator->()const{
+                return &p_value(*p);
+            }
+            V& operator[](difference_type i)const{
+                return p_value(p[i]);
+            }
+            /**
+             * Converts to tree iterator
+             * @return depth-first iterator to the same node, const if V is
+             */
+            auto base()const{
+                using base_iterator = std::conditional_t<std::is_const<V>::value,
+                    const_depth_first_iterator, depth_first_iterator>;
+                return base_iterator(depth_first_iterator(*p));
+            }
+            iterator& operator++(){
+                ++p;
+                return *this;
+            }
+            iterator operator++(int){
+                return iterator(p++);
+            }
+            iterator& operator--(){
+                --p;
+                return *this;
+            }
+            iterator operator--(int){
+                return iterator(p--);
+            }
+            iterator& operator+=(difference_type i){
+                p += i;
+                return *this;
+            }
+            iterator& operator-=(difference_type i){
+                p -= i;
+                return *this;
+            }
+            friend iterator operator+(iterator it, difference_type i){
+                return it += i;
+            }
+            friend iterator operator+(difference_type i, iterator it){
+                return it += i;
+            }
+            friend iterator operator-(iterator it, difference_type i){
+                return it -= i;
+            }
+            friend difference_type operator-(const iterator &lhs, const iterator &rhs){
+                return lhs.p - rhs.p;
+            }
+            friend bool operator==(const iterator &lhs, const iterator &rhs){
+                return lhs.p == rhs.p;
+            }
+            friend bool operator!=(const iterator &lhs, const iterator &rhs){
+                return lhs.p != rhs.p;
+            }
+            friend bool operator<(const iterator &lhs, const iterator &rhs){
+                return lhs.p < rhs.p;
+            }
+            friend bool operator>(const iterator &lhs, const iterator &rhs){
+                return lhs.p > rhs.p;
+            }
+            friend bool operator<=(const iterator &lhs, const iterator &rhs){
+                return lhs.p <= rhs.p;
+            }
+            friend bool operator>=(const iterator &lhs, const iterator &rhs){
+                return lhs.p >= rhs.p;
+            }
+        };
+        basic_frozen_range() = default;
+        /**
+         * Constructor
+         * @param nodes nodes of a tree in depth-first order
+         */
+        basic_frozen_range(std::vector<node*> &&nodes)
+            :nodes(std::move(nodes))
+        {}
+        iterator begin()const{
+            return iterator(nodes.data());
+        }
+        iterator end()const{
+            return iterator(nodes.data() + nodes.size());
+        }
+        size_t size()const{
+            return nodes.size();
+        }
+        V& operator[](size_t i)const{
+            return p_value(nodes[i]);
+        }
+    private:
+        /**
+         * Value of a node, a mutable one may be written without a tree knowing it
+         */
+        static V& p_value(node* n){
+            if constexpr(!std::is_const<V>::value){
+                p_on_access(n);
+            }
+            return n->value();
+        }
+    };
+    using frozen_range = basic_frozen_range<T>;
+    using const_frozen_range = basic_frozen_range<const T>;
+private:
+    /**
+     * Node storage shared by all trees of one type in a thread
+     * Hands out nodes from blocks and keeps erased nodes in a free list,
+     * so inserts and erases don't go to the heap for every node.
+     * Blocks are owned by a process-wide list and are not returned to
+     * the system before the end of a program, so a tree may outlive
+     * a thread it was built in, and memory stays at its peak.
+     * Free slots of an exiting thread are handed to other threads.
+     */
+    class node_pool{
+        /**
+         * Storage for one node
+         * Holds either a constructed node or a link to the next free slot.
+         */
+        union slot{
+            slot* next; /**< Next free slot, valid while slot is free */
+            node n; /**< Node, valid while slot is in use */
+            slot(){}
+            ~slot(){}
+        };
+        /**
+         * Process-wide state of pools of one node type
+         */
+        struct shared_state{
+            std::mutex lock; /**< Guards all members */
+            std::vector<std::unique_ptr<slot[]>> blocks; /**< All blocks */
+            slot* free_list = nullptr; /**< Slots left by exited threads */
+            /** Pools made after thread-local objects of their threads are gone */
+            std::vector<std::unique_ptr<node_pool>> late_pools;
+        };
+        /**
+         * Hands a pool of a thread to other threads when the thread exits
+         */
+        struct thread_guard{
+            node_pool* &pool; /**< Pool of a thread */
+            bool &exited; /**< Set when the pool is destroyed */
+            ~thread_guard();
+        };
+        /**
+         * Gives process-wide state, never destroyed
+         */
+        static shared_state& p_shared();
+        slot* free_list; /**< Head of released slots */
+        slot* cur, /**< Begin of unused space in the last block */
+            *cur_end; /**< End of the last block */
+        size_t next_size; /**< Size of the next block to allocate */
+        /**
+         * Refills a pool. Single slot is taken from slots of exited
+         * threads if there are any, otherwise a new block is allocated
+         * and becomes the bump region.
+         * Unused space of the previous block goes to the free list.
+         * @param count minimal number of slots in a block
+         */
+        void p_grow(size_t count);
         /**
-         * Postfix decrement operator
-         * @return copy of current iterator
+         * Default constructor, allocates nothing
          */
-        depth_first_reverse_iterator operator--(int);
-    };
-
-    /**
-     * Breadth-first iterator
-     * Iterates through tree nodes from left to right.
-     * Classic queue approach.
-     */ 
-    class breadth_first_iterator:public iterator_base {
-        node* end;
+        node_pool();
     public:
+        node_pool(const node_pool &rhs) = delete;
+        node_pool& operator=(const node_pool &rhs) = delete;
         /**
-         * Constructor
-         * @param n node for an iterator
+         * Destructor, hands free slots to other threads
          */
-        breadth_first_iterator(node* n);
+        ~node_pool();
         /**
-         * Copy Constructor
-         * @param rhs rvalue of a copying
+         * Gives pool of a calling thread
+         * A thread gets a new pool if it is called after thread-local
+         * objects are destroyed, e.g. by a tree with static storage.
+         * Such pool is kept in process-wide state until the end of a program.
+         * @return thread-local pool
          */
-        breadth_first_iterator(const iterator_base &rhs);
+        static node_pool& local();
         /**
-         * Prefix increment operator
-         * @return reference to current iterator
+         * Constructs a node in a free slot
+         * @return pointer to default constructed node
          */
-        breadth_first_iterator& operator++();
+        node* allocate();
         /**
-         * Postfix increment operator
-         * @return copy of current iterator
+         * Constructs count nodes in one contiguous block
+         * @param count number of nodes
+         * @return pointer to first of count default constructed nodes
          */
-        breadth_first_iterator operator++(int);
+        node* allocate(size_t count);
         /**
-         * Prefix decrement operator
-         * @return reference to current iterator
+         * Makes sure that next count nodes are taken without allocating
+         * a block, if they are not taken from the free list.
+         * @param count number of nodes
          */
-        breadth_first_iterator& operator--() = delete; //not impl
+        void reserve(size_t count);
         /**
-         * Postfix decrement operator
-         * @return copy of current iterator
+         * Destroys a node and puts its slot to the free list
+         * @param n node to destroy, may be nullptr
          */
-        breadth_first_iterator operator--(int) = delete; //not impl
-    private:
-        std::queue<node *> q;
+        void deallocate(node* n);
     };
-private:
 
     node* root, /**< Begin of a tree, has value */
-        *foot; /**< End of a tree, hasn't value */
+        *foot; /**< End of a tree, hasn't value, points to foot_node */
+    node foot_node; /**< Embedded foot, so empty tree allocates nothing */
+    /**
+     * Gives storage of nodes for a calling thread
+     */
+    static node_pool& pool(){
+        return node_pool::local();
+    }
     void p_init(){
-        root = new node();
-        foot = root;
+        foot = &foot_node;
+        root = foot;
     }
-
-    void p_erase_children(node *beg, node *end){
-        for(auto n = beg; n!= end;){
+    /**
+     * Takes a node from the pool, with a value slot if values are separated
+     */
+    node* p_new_node(){
+        auto n = pool().allocate();
+        if constexpr(p_separated){
+            this->p_values.acquire(n->ptr);
+        }
+        return n;
+    }
+    /**
+     * Takes count contiguous nodes from the pool, with value slots
+     */
+    node* p_new_nodes(size_t count){
+        auto nodes = pool().allocate(count);
+        if constexpr(p_separated){
+            this->p_values.reserve(this->p_values.size() + count);
+            for(size_t i = 0; i < count; i++){
+                this->p_values.acquire(nodes[i].ptr);
+            }
+        }
+        return nodes;
+    }
+    /**
+     * Returns a node and its value slot, may be nullptr
+     */
+    void p_delete_node(node* n){
+        if(!n){
+            return;
+        }
+        p_on_destroy(n);
+        if constexpr(p_separated){
+            if(n->ptr){
+                this->p_values.release(n->ptr);
+            }
+        }
+        pool().deallocate(n);
+    }
+    /**
+     * Releases all nodes of a tree to the pool, foot is kept
+     * Links of foot and root are not updated.
+     */
+    void p_release_all(){
+        for(auto n = root; n != foot;){
+            auto next = n->right;
+            p_release_subtree(n);
+            n = next;
+        }
+    }
+    /**
+     * Makes a chain of right-linked siblings from a range of values.
+     * Nodes of a chain are allocated in one block.
+     * @return first and last node of a chain, nullptrs if range is empty
+     */
+    template<class FwdIt>
+    std::pair<node*, node*> p_make_chain(FwdIt first, FwdIt last,
+        node* parent, std::forward_iterator_tag)
+    {
+        auto count = static_cast<size_t>(std::distance(first, last));
+        if(!count){
+            return {nullptr, nullptr};
+        }
+        auto nodes = p_new_nodes(count);
+        for(size_t i = 0; i < count; i++, ++first){
+            auto tmp = nodes + i;
+            tmp->parent = parent;
+            tmp->left = i? tmp - 1 : nullptr;
+            tmp->right = (i + 1 < count)? tmp + 1 : nullptr;
+            tmp->value() = *first;
+        }
+        return {nodes, nodes + count - 1};
+    }
+    /**
+     * Makes a chain of right-linked siblings from a single-pass range.
+     * Length is unknown beforehand, so nodes are allocated one by one.
+     * @return first and last node of a chain, nullptrs if range is empty
+     */
+    template<class InputIt>
+    std::pair<node*, node*> p_make_chain(InputIt first, InputIt last,
+        node* parent, std::input_iterator_tag)
+    {
+        node* beg = nullptr, *end = nullptr;
+        for(; first != last; ++first){
+            auto tmp = p_new_node();
+            tmp->parent = parent;
+            tmp->left = end;
+            if(end){
+                end->right = tmp;
+            }else{
+                beg = tmp;
+            }
+            end = tmp;
+            tmp->value() = *first;
+        }
+        return {beg, end};
+    }
+    /**
+     * Makes a chain of right-linked siblings from any input range.
+     * @return first and last node of a chain, nullptrs if range is empty
+     */
+    template<class InputIt>
+    std::pair<node*, node*> p_make_chain(InputIt first, InputIt last,
+        node* parent)
+    {
+        return p_make_chain(first, last, parent,
+            typename std::iterator_traits<InputIt>::iterator_category());
+    }
+    /**
+     * Checks if a is n or one of its parents
+     */
+    static bool p_is_ancestor(const node* a, const node* n){
+        for(; n; n = n->parent){
+            if(n == a){
+                return true;
+            }
+        }
+        return false;
+    }
+    /**
+     * Unlinks a node with its subtree from neighbours and parent
+     * Node keeps its own links.
+     * @param n node to unlink
+     */
+    void p_unlink(node* n){
+        if(n->left){
+            n->left->right = n->right;
+        }
+        if(n->right){
+            n->right->left = n->left;
+        }
+        if(n->parent){
+            if(n->parent->child_begin == n){
+                n->parent->child_begin = n->right;
+            }
+            if(n->parent->child_end == n){
+                n->parent->child_end = n->left;
+            }
+        }
+        if(n == root){
+            root = n->right;
+        }
+    }
+    /**
+     * Links a chain of siblings between left and right nodes
+     * Updates parent's children and root if chain becomes first.
+     * @param parent parent of a chain, nullptr for top level
+     * @param left node to link before chain, may be nullptr
+     * @param right node to link after chain, may be nullptr
+     * @param chain first and last node of a chain
+     */
+    void p_splice(node* parent, node* left, node* right,
+        std::pair<node*, node*> chain)
+    {
+        chain.first->left = left;
+        chain.second->right = right;
+        if(left){
+            left->right = chain.first;
+        }else if(parent){
+            parent->child_begin = chain.first;
+        }else{
+            root = chain.first;
+        }
+        if(right){
+            right->left = chain.second;
+        }else if(parent){
+            parent->child_end = chain.second;
+        }
+    }
+    /**
+     * Gives next node in depth-first order outside of a subtree
+     * @param n root of a subtree
+     * @return right sibling of n or of its nearest parent having one
+     */
+    static node* p_skip_subtree(node* n){
+        while(!n->right){
+            n = n->parent;
+        }
+        return n->right;
+    }
+    /**
+     * Releases an unlinked subtree to the pool, children first.
+     * Iterative, so depth of a subtree is not limited by the stack.
+     * @param n root of an unlinked subtree
+     * @return number of released nodes
+     */
+    size_t p_release_subtree(node* n){
+        size_t result = 0;
+        for(auto cur = n;;){
+            while(cur->child_begin){
+                cur = cur->child_begin;
+            }
+            if(cur == n){
+                p_delete_node(cur);
+                return result + 1;
+            }
+            auto next = cur->right;
+            cur->parent->child_begin = next;
+            if(!next){
+                next = cur->parent;
+            }
+            p_delete_node(cur);
+            result++;
+            cur = next;
+        }
+    }
+    /**
+     * Counts nodes in a subtree, stops early at limit
+     * @param n root of a subtree
+     * @param limit number of nodes to stop counting at
+     * @return number of nodes in a subtree, but not more than limit
+     */
+    static size_t p_count(node* n, size_t limit){
+        auto top = n;
+        size_t result = 0;
+        while(++result < limit){
+            if(n->child_begin){
+                n = n->child_begin;
+                continue;
+            }
+            while(n != top && !n->right){
+                n = n->parent;
+            }
+            if(n == top){
+                break;
+            }
+            n = n->right;
+        }
+        return result;
+    }
+    /**
+     * Merges two sorted right-linked lists of nodes, stable.
+     * Nodes of lhs go first among equal ones.
+     * @return head of merged list, right-linked only
+     */
+    template<class Compare>
+    static node* p_merge(node* lhs, node* rhs, Compare &cmp){
+        node* head = nullptr;
+        node** tail = &head;
+        while(lhs && rhs){
+            if(cmp(rhs->value(), lhs->value())){
+                *tail = rhs;
+                rhs = rhs->right;
+            }else{
+                *tail = lhs;
+                lhs = lhs->right;
+            }
+            tail = &(*tail)->right;
+        }
+        *tail = lhs? lhs : rhs;
+        return head;
+    }
+    /**
+     * Sorts children of a node by relinking them, stable.
+     * Bottom-up merge sort, values are not moved.
+     * @param parent node to sort children of
+     */
+    template<class Compare>
+    static void p_sort_children(node* parent, Compare &cmp){
+        if(parent->child_begin == parent->child_end){
+            return;
+        }
+        node* bins[64] = {}; //bins[i] holds sorted run of 2^i nodes
+        size_t used = 0;
+        for(auto n = parent->child_begin; n;){
+            auto carry = n;
+            n = n->right;
+            carry->right = nullptr;
+            size_t i = 0;
+            for(; bins[i]; i++){
+                carry = p_merge(bins[i], carry, cmp);
+                bins[i] = nullptr;
+            }
+            bins[i] = carry;
+            used = std::max(used, i + 1);
+        }
+        node* head = nullptr;
+        for(size_t i = 0; i < used; i++){
+            if(bins[i]){
+                head = p_merge(bins[i], head, cmp);
+            }
+        }
+        node* prev = nullptr;
+        for(auto n = head; n; n = n->right){
+            n->left = prev;
+            prev = n;
+        }
+        parent->child_begin = head;
+        parent->child_end = prev;
+    }
+    /**
+     * Sorts children of every node of a subtree, sequentially.
+     * Walks subtree depth-first, children are sorted before visiting them.
+     * @param n root of a subtree
+     */
+    template<class Compare>
+    static void p_sort_subtree(node* n, Compare &cmp){
+        auto top = n;
+        while(true){
+            p_sort_children(n, cmp);
             if(n->child_begin){
-                auto nbeg = n->child_begin;
-                auto nend = n->child_end;
-                p_erase_children(nbeg, nend);
+                n = n->child_begin;
+                continue;
+            }
+            while(n != top && !n->right){
+                n = n->parent;
             }
-            auto bak = n->right;
-            delete n;
-            n = bak;
+            if(n == top){
+                return;
+            }
+            n = n->right;
+        }
+    }
+    /**
+     * Notifies policies, see policy::base for meaning of hooks
+     * Arguments are unused if a tree has no policies.
+     */
+    void p_on_link([[maybe_unused]] node* first, [[maybe_unused]] node* last){
+        (Policies::on_link(*this, first, last), ...);
+    }
+    void p_on_unlink([[maybe_unused]] node* n){
+        (Policies::on_unlink(*this, n), ...);
+    }
+    void p_on_modify([[maybe_unused]] node* n){
+        (Policies::on_modify(*this, n), ...);
+    }
+    void p_on_reorder([[maybe_unused]] node* parent){
+        (Policies::on_reorder(*this, parent), ...);
+    }
+    static void p_on_access([[maybe_unused]] node* n){
+        (Policies::on_access(n), ...);
+    }
+    void p_on_rebuild([[maybe_unused]] node* n){
+        (Policies::on_rebuild(*this, n), ...);
+    }
+    void p_on_destroy([[maybe_unused]] node* n){
+        (Policies::on_destroy(*this, n), ...);
+    }
+    /**
+     * Moves data of policies from one node to another
+     */
+    static void p_move_data([[maybe_unused]] node* to, [[maybe_unused]] node* from){
+        ((static_cast<typename Policies::template node_data<node>&>(*to) =
+            std::move(static_cast<typename Policies::template node_data<node>&>(*from))), ...);
+    }
+    /**
+     * Atomic access to a link of a node shared between threads
+     */
+    static node* p_atomic_load(node* &link){
+#if defined(__cpp_lib_atomic_ref)
+        return std::atomic_ref<node*>(link).load(std::memory_order_acquire);
+#else
+        return __atomic_load_n(&link, __ATOMIC_ACQUIRE);
+#endif
+    }
+    static void p_atomic_store(node* &link, node* n){
+#if defined(__cpp_lib_atomic_ref)
+        std::atomic_ref<node*>(link).store(n, std::memory_order_release);
+#else
+        __atomic_store_n(&link, n, __ATOMIC_RELEASE);
+#endif
+    }
+    /**
+     * Replaces link with n if it equals expected,
+     * otherwise loads current link to expected
+     * @return "true" if link was replaced
+     */
+    static bool p_atomic_cas(node* &link, node* &expected, node* n){
+#if defined(__cpp_lib_atomic_ref)
+        return std::atomic_ref<node*>(link).compare_exchange_weak(expected, n,
+            std::memory_order_acq_rel, std::memory_order_acquire);
+#else
+        return __atomic_compare_exchange_n(&link, &expected, n, true,
+            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#endif
+    }
+    /**
+     * Runs fn(first, last) over chunks of [0, count) on threads
+     * @param count number of items
+     * @param threads number of threads, 1 runs fn in a calling thread
+     * @param fn function of a chunk
+     * @param grain minimal size of a chunk
+     */
+    template<class Fn>
+    static void p_parallel_for(size_t count, size_t threads, Fn fn, size_t grain = 1024){
+        if(threads < 2){
+            fn(size_t(0), count);
+            return;
+        }
+        const size_t chunk = std::max<size_t>(grain, count / (threads * 8));
+        std::atomic<size_t> next(0);
+        auto worker = [&](){
+            for(auto i = next.fetch_add(chunk); i < count; i = next.fetch_add(chunk)){
+                fn(i, std::min(count, i + chunk));
+            }
+        };
+        std::vector<std::thread> workers;
+        for(size_t i = 1; i < threads; i++){
+            workers.emplace_back(worker);
+        }
+        worker();
+        for(auto &w:workers){
+            w.join();
+        }
+    }
+    /**
+     * Takes all nodes of rhs, leaves rhs empty
+     * Current tree must have no nodes.
+     * @param rhs tree to take nodes from
+     */
+    void p_take(tree &rhs){
+        foot_node = std::move(rhs.foot_node);
+        //state of policies goes with nodes
+        ((static_cast<typename Policies::template extension<tree>&>(*this) =
+            std::move(static_cast<typename Policies::template extension<tree>&>(rhs)),
+        static_cast<typename Policies::template extension<tree>&>(rhs) =
+            typename Policies::template extension<tree>()), ...);
+        if(rhs.empty()){
+            root = foot;
+        }else{
+            root = rhs.root;
+            foot->left->right = foot;
         }
-        delete end;
+        rhs.root = rhs.foot;
+        rhs.foot->left = nullptr;
+        rhs.p_on_rebuild(nullptr);
     }
-    void p_transfer(const tree<T> &rhs){
+    /**
+     * Copies structure and values of rhs into an empty tree.
+     * Single depth-first pass, new nodes are linked as they are made.
+     */
+    void p_transfer(const tree &rhs){
         if(rhs.empty()){
             return;
         }
-        auto it = depth_first_iterator(rhs.end());
-        it--;
-        auto prev_dist = algo::depth_between(it, rhs.begin());
-        std::deque<std::pair<node*, size_t>> queue;
-        while(it != rhs.begin()){
-            auto tmp = new node();
-            tmp->value = it.n->value;
-            auto it_dist = algo::depth_between(it, rhs.begin());
-            if(it_dist < prev_dist){ //we moved up
-                tmp->child_begin = queue.back().first;
-                auto bak = tmp->child_begin;
-                while(!queue.empty() && queue.back().second != it_dist){
-                    auto n = queue.back().first;
-                    bak = n;
-                    n->parent = tmp;
-                    queue.pop_back();
-                }
-                tmp->child_end = bak;
-                tmp->right = queue.back().first;
-                queue.back().first->left = tmp;
-            }else if(it_dist == prev_dist && !queue.empty()){
-                tmp->right = queue.back().first;
-                queue.back().first->left = tmp;
-            }
-            queue.emplace_back(tmp, it_dist);//NOTE:reverse order
-            prev_dist = it_dist;
-            it--;
-        }
-        set_root(it.n->value);
-        root->child_begin = queue.back().first;
-        auto bak = root->child_begin;
-        while(!queue.empty()){
-            auto n = queue.back().first;
-            bak = n;
-            n->parent = root;
-            queue.pop_back();
-        }
-        root->child_end = bak;
+        node* parent = nullptr; //copy of parent of src
+        node* prev = nullptr; //last copied sibling of src
+        auto src = rhs.root;
+        while(src != rhs.foot){
+            auto tmp = p_new_node();
+            tmp->value() = src->value();
+            tmp->parent = parent;
+            tmp->left = prev;
+            if(prev){
+                prev->right = tmp;
+            }else if(parent){
+                parent->child_begin = tmp;
+            }else{
+                root = tmp;
+            }
+            if(parent){
+                parent->child_end = tmp;
+            }
+            if(src->child_begin){
+                parent = tmp;
+                prev = nullptr;
+                src = src->child_begin;
+                continue;
+            }
+            prev = tmp;
+            while(!src->right){
+                src = src->parent;
+                prev = parent;
+                parent = parent->parent;
+            }
+            src = src->right;
+        }
+        prev->right = foot;
+        foot->left = prev;
+        p_on_rebuild(nullptr);
     }
 public:
     using value_type = T;
@@ -347,76 +2359,251 @@ public:
     using const_pointer = const T*;
     using const_reference = const T&;
     using iterator = depth_first_iterator;
-    using const_iterator = const depth_first_iterator;
+    using const_iterator = const_depth_first_iterator;
+    /**
+     * Minimal number of nodes for an operation to be spread over threads
+     */
+    static constexpr size_type parallel_threshold = 1 << 14;
+    /**
+     * Parent index of a top level node in parent arrays
+     */
+    static constexpr size_type npos = static_cast<size_type>(-1);
 
     /**
-     * Copy/move constructor for a value
+     * Copy/move constructor for a value
+     */
+    tree(T&& val);
+    /**
+     * Copy constructor, copies tree structire and values
+     */
+    tree(const tree &rhs);
+    /**
+     * Move constructor, moves entire tree
+     * NOTE: move constructor is far more optimized
+     */
+    tree(tree &&rhs);
+    /**
+     * Default constructor
+     */
+    tree();
+    /**
+     * Destructor
+     */
+    ~tree();
+    /**
+     * Assign copy operator, clears current tree,
+     * copies rhs structure and values
+     */
+    tree& operator=(const tree &rhs);
+    /**
+     * Assign move operator, clears current tree,
+     * copies rhs structure and values.
+     * NOTE: move assigment is far more optimized
+     */
+    tree& operator=(tree &&rhs);
+    /**
+     * Checks if tree is empty.
+     * If root's address equals foot's address, return true.
+     */
+    bool empty()const;
+    /**
+     * Clears current tree, resets it's structure
+     */
+    void clear();
+    /**
+     * Erases given node and all it's children
+     * @param it iterator to erase
+     * @return next iterator of given iterator
+     */
+    template<class It>
+    It erase(const It &it);
+    /**
+     * Erases all nodes with values matching a predicate in one pass
+     * Children of an erased node take its place among its siblings.
+     * @param pred unary predicate on values
+     * @return number of erased nodes
+     */
+    template<class Pred>
+    size_type erase_if(Pred pred);
+    /**
+     * Erases all subtrees with roots matching a predicate in one pass
+     * Nodes inside of an erased subtree are not checked.
+     * @param pred unary predicate on values
+     * @return number of erased nodes
+     */
+    template<class Pred>
+    size_type prune_if(Pred pred);
+    /**
+     * Preallocates storage, so next n inserts don't allocate
+     * @param n number of nodes to reserve
+     */
+    void reserve(size_type n);
+    /**
+     * Relocates all nodes into one block in depth-first order
+     * Restores traversal locality after many inserts and erases.
+     * Invalidates all iterators and frozen ranges of a tree,
+     * values are moved, not copied.
+     */
+    void compact();
+    /**
+     * Builds a tree from a parent array
+     * Node i gets values[i] and becomes a child of parents[i],
+     * or a top level node if parents[i] is npos. Siblings keep order
+     * of their indices. Parents must form a forest. Nodes are allocated
+     * in one block, children are counting-sorted and linked in parallel
+     * for big arrays. The sort is stable: indices are split by ranges
+     * of parents first, then each thread sorts its own range of parents.
+     * @param parents random-access range of parent indices
+     * @param values random-access range of values, moved from if rvalue
+     * @param threads number of threads, all cores for big arrays if 0
+     * @return built tree
+     */
+    template<class Parents, class Values>
+    static tree from_parent_array(const Parents &parents, Values &&values, size_type threads=0);
+    /**
+     * Exports a tree as a parent array in depth-first order
+     * Parent of each node is written before it, top level nodes get npos.
+     * @param parents output iterator for parent indices
+     * @param values output iterator for values
+     * @return ends of written ranges
+     */
+    template<class IndexOut, class ValueOut>
+    std::pair<IndexOut, ValueOut> to_parent_array(IndexOut parents, ValueOut values)const;
+    /**
+     * Sets root value, copy or move
+     * If tree is empty, inserts root node
+     * @param val value to set root to, copy or move
+     * @return iterator to root
+     */
+    template<class X, class It=depth_first_iterator>
+    It set_root(X&& val);
+    /**
+     * Returns iterator to root of a tree
+     * @return iterator to root of a tree
+     */
+    template<class It=depth_first_iterator>
+    It begin();
+    /**
+     * Returns read-only iterator to root of a tree
+     * @return const iterator to root of a tree
+     */
+    template<class It=depth_first_iterator>
+    basic_const_iterator<It> begin()const;
+    /**
+     * Returns iterator to foot of a tree
+     * @return iterator to foot of a tree
+     */
+    template<class It=depth_first_iterator>
+    It end();
+    /**
+     * Returns read-only iterator to foot of a tree
+     * @return const iterator to foot of a tree
+     */
+    template<class It=depth_first_iterator>
+    basic_const_iterator<It> end()const;
+    /**
+     * Returns post-order iterator to first node, left-most leaf of a root
+     * @return post-order iterator to first node of a tree
+     */
+    post_order_iterator begin_post()const;
+    /**
+     * Returns post-order iterator to foot of a tree
+     * @return post-order iterator to foot of a tree
      */
-    tree(T&& val);
+    post_order_iterator end_post()const;
     /**
-     * Copy constructor, copies tree structire and values
+     * Returns iterator to first leaf of a tree
+     * @return leaf iterator to first leaf of a tree
      */
-    tree(const tree<T> &rhs);
+    leaf_iterator begin_leaf()const;
     /**
-     * Move constructor, moves entire tree
-     * NOTE: move constructor is far more optimized
+     * Returns leaf iterator to foot of a tree
+     * @return leaf iterator to foot of a tree
      */
-    tree(tree<T> &&rhs);
+    leaf_iterator end_leaf()const;
     /**
-     * Default constructor
+     * Returns const iterator to root of a tree
+     * @return const depth-first iterator to root of a tree
      */
-    tree();
+    const_iterator cbegin()const;
     /**
-     * Destructor
+     * Returns const iterator to foot of a tree
+     * @return const depth-first iterator to foot of a tree
      */
-    ~tree();
+    const_iterator cend()const;
     /**
-     * Assign copy operator, clears current tree,
-     * copies rhs structure and values
+     * Returns range of children of a given iterator
+     * @param it iterator to a parent
+     * @return range of sibling iterators over children
      */
-    tree& operator=(const tree<T> &rhs);
+    range<sibling_iterator> children(const iterator_base &it);
     /**
-     * Assign move operator, clears current tree,
-     * copies rhs structure and values.
-     * NOTE: move assigment is far more optimized
+     * Returns read-only range of children of a given iterator
+     * @param it iterator to a parent
+     * @return range of const sibling iterators over children
      */
-    tree& operator=(tree<T> &&rhs);
+    range<const_sibling_iterator> children(const iterator_base &it)const;
     /**
-     * Checks if tree is empty.
-     * If root's address equals foot's address, return true.
+     * Writes path from a node up to a top level, both included
+     * Walks parent links once, allocates nothing.
+     * @param it iterator to a first node of a path
+     * @param out output iterator of a buffer
+     * @return end of written path
      */
-    bool empty()const;
+    template<class It, class OutIt>
+    static OutIt path_to_root(const It &it, OutIt out);
     /**
-     * Clears current tree, resets it's structure
+     * Returns depth-first range over a tree
+     * @return range from begin() to end()
      */
-    void clear();
+    range<depth_first_iterator> dfs();
     /**
-     * Erases given node and all it's children
-     * @param it iterator to erase
-     * @return next iterator of given iterator
+     * Returns read-only depth-first range over a tree
+     * @return range from cbegin() to cend()
      */
-    template<class It>
-    It erase(const It &it);
+    range<const_depth_first_iterator> dfs()const;
     /**
-     * Sets root value, copy or move
-     * If tree is empty, inserts root node
-     * @param val value to set root to, copy or move
-     * @return iterator to root
+     * Returns breadth-first range over a tree
+     * @return range of breadth-first iterators from root to foot
      */
-    template<class X, class It=depth_first_iterator>
-    It set_root(X&& val);
+    range<breadth_first_iterator> bfs();
     /**
-     * Returns iterator to root of a tree
-     * @return iterator to root of a tree
+     * Returns read-only breadth-first range over a tree
+     * @return range of const breadth-first iterators from root to foot
      */
-    template<class It=depth_first_iterator>
-    It begin()const;
+    range<const_breadth_first_iterator> bfs()const;
     /**
-     * Returns iterator to foot of a tree
-     * @return iterator to foot of a tree
+     * Returns post-order range over a tree
+     * @return range from begin_post() to end_post()
      */
-    template<class It=depth_first_iterator>
-    It end()const;
+    range<post_order_iterator> post_order();
+    /**
+     * Returns read-only post-order range over a tree
+     * @return range of const post-order iterators
+     */
+    range<const_post_order_iterator> post_order()const;
+    /**
+     * Returns range over leaves of a tree
+     * @return range from begin_leaf() to end_leaf()
+     */
+    range<leaf_iterator> leaves();
+    /**
+     * Returns read-only range over leaves of a tree
+     * @return range of const leaf iterators
+     */
+    range<const_leaf_iterator> leaves()const;
+    /**
+     * Makes random-access range over values in depth-first order
+     * Range is valid until structure of a tree changes.
+     * @return frozen range of all nodes
+     */
+    frozen_range freeze();
+    /**
+     * Makes read-only random-access range over values in depth-first order
+     * Range is valid until structure of a tree changes.
+     * @return const frozen range of all nodes
+     */
+    const_frozen_range freeze()const;
     /**
      * Returns number of nodes in a tree
      * @return size of a tree, difference of begin() and end()
@@ -444,6 +2631,19 @@ public:
      */
     template<class It, class X>
     It append_child(It& it, X&& val);
+    /**
+     * Appends child with value, safe to call from many threads at once
+     * Lock-free: a node is taken from a thread-local pool and linked
+     * by CAS on parent's children end, so appends under different
+     * parents never contend. No other changes of a tree may run
+     * concurrently, a child is visible to traversals after threads join.
+     * Not available with policies, they are not notified concurrently.
+     * @param it iterator to a parent
+     * @param val rhs for appending, copy or move
+     * @return iterator to resulting child
+     */
+    template<class It, class X>
+    It concurrent_append_child(const It& it, X&& val);
     /**
      * Prepends child with value to a given iterator (left-most child)
      * @param it iterator for child prepend
@@ -452,13 +2652,102 @@ public:
      */
     template<class It, class X>
     It prepend_child(It& it, X&& val);
+    /**
+     * Replaces value of a node, keeps policies up to date
+     * @param it iterator to a node
+     * @param val rhs for replacing, copy or move
+     */
+    template<class It, class X>
+    void replace(const It& it, X&& val);
+    /**
+     * Changes value of a node in place, keeps policies up to date
+     * @param it iterator to a node
+     * @param fn callable taking reference to a value
+     */
+    template<class It, class Fn>
+    void modify(const It& it, Fn fn);
+    /**
+     * Appends children with values from a range (right-most children)
+     * Nodes are allocated in one block when range is multi-pass.
+     * Values are moved if range gives rvalues, e.g. std::move_iterator.
+     * @param it iterator for children append
+     * @param first begin of a range of values
+     * @param last end of a range of values
+     * @return iterator to first appended child, end() if range is empty
+     */
+    template<class It, class InputIt>
+    It append_children(It& it, InputIt first, InputIt last);
+    /**
+     * Prepends children with values from a range (left-most children)
+     * Children keep order of a range.
+     * @param it iterator for children prepend
+     * @param first begin of a range of values
+     * @param last end of a range of values
+     * @return iterator to first prepended child, end() if range is empty
+     */
+    template<class It, class InputIt>
+    It prepend_children(It& it, InputIt first, InputIt last);
+    /**
+     * Inserts values from a range left from given iterator (left neighbours)
+     * @param it iterator for relative left insert
+     * @param first begin of a range of values
+     * @param last end of a range of values
+     * @return iterator to first inserted node, end() if range is empty
+     */
+    template<class It, class InputIt>
+    It insert_range_left(It& it, InputIt first, InputIt last);
+    /**
+     * Inserts values from a range right from given iterator (right neighbours)
+     * @param it iterator for relative right insert
+     * @param first begin of a range of values
+     * @param last end of a range of values
+     * @return iterator to first inserted node, end() if range is empty
+     */
+    template<class It, class InputIt>
+    It insert_range_right(It& it, InputIt first, InputIt last);
+    /**
+     * Sorts children of a given iterator, stable
+     * Children are relinked, values are not moved,
+     * so iterators to children stay valid.
+     * @param it iterator to sort children of
+     * @param cmp comparator of values, less by default
+     */
+    template<class It, class Compare = std::less<T>>
+    void sort_children(const It& it, Compare cmp = Compare());
+    /**
+     * Moves node with its subtree left from given position (left neighbour)
+     * Nodes are relinked, iterators stay valid.
+     * @param it iterator to move, must not be parent of pos
+     * @param pos iterator for relative left move
+     * @return iterator to moved node
+     */
+    template<class It>
+    It move_left(const It& it, const It& pos);
+    /**
+     * Moves node with its subtree right from given position (right neighbour)
+     * Nodes are relinked, iterators stay valid.
+     * @param it iterator to move, must not be parent of pos
+     * @param pos iterator for relative right move
+     * @return iterator to moved node
+     */
+    template<class It>
+    It move_right(const It& it, const It& pos);
+    /**
+     * Sorts children of every node in a subtree of given iterator, stable
+     * Subtrees of different children are sorted in parallel
+     * when a subtree has at least parallel_threshold nodes.
+     * @param it iterator to root of a subtree
+     * @param cmp comparator of values, less by default
+     */
+    template<class It, class Compare = std::less<T>>
+    void sort_subtree(const It& it, Compare cmp = Compare());
     /**
      * Equals operator
      * Checks if rhs structure and values are equeal to current tree.
      * @param rhs tree to check equality
      * @return Equality. "true" if trees are equal. "false" otherwise.
      */
-    bool operator==(const tree<T> &rhs)const;
+    bool operator==(const tree &rhs)const;
     /**
      * Non-equals operator
      * Checks if rhs structure and values are not equeal to current tree.
@@ -466,64 +2755,269 @@ public:
      * @return Non-equality. "true" if trees are non-equal.
      *      "false" otherwise.
      */
-    bool operator!=(const tree<T> &rhs)const;
+    bool operator!=(const tree &rhs)const;
 };
 
-//*** node ***
+/**
+ * Single change of a tree in an edit script
+ * Paths are indices of children from top level down,
+ * valid for a tree with all previous edits of a script applied.
+ */
+template<class T>
+struct edit{
+    enum class kind{
+        insert, /**< Inserts value at path, last index is its position */
+        erase, /**< Erases node at path with its subtree */
+        move, /**< Moves node at path with its subtree to position "to" among siblings */
+        update /**< Replaces value of node at path */
+    };
+    kind op; /**< Kind of a change */
+    std::vector<size_t> path; /**< Path to a changed node */
+    size_t to; /**< New position of a moved node */
+    T value; /**< Value of inserted or updated node */
+};
+
+/**
+ * Edit script, edits are applied in order
+ */
 template<class T>
-tree<T>::node::node() {
+using patch = std::vector<edit<T>>;
+
+/**
+ * Makes edit script that turns lhs into rhs
+ * Subtrees are compared by hashes, so identical subtrees are skipped
+ * and similar trees are compared in near-linear time.
+ * Children are matched by subtree hash first, then by position;
+ * moves are found among siblings only. Equal hashes are confirmed
+ * by comparing subtrees, so a hash collision never loses a change.
+ * @tparam Hash hash functor of values
+ * @param lhs source tree
+ * @param rhs target tree
+ * @return edit script, empty if trees are equal
+ */
+template<class Hash = policy::std_hash, class T, class... Policies>
+patch<T> diff(const tree<T, Policies...> &lhs, const tree<T, Policies...> &rhs);
+
+/**
+ * Applies edit script made by diff in place
+ * @param t tree to change, must be equal to lhs of diff
+ * @param script edit script
+ */
+template<class T, class... Policies>
+void apply_patch(tree<T, Policies...> &t, const patch<T> &script);
+
+/**
+ * Erases all nodes with values matching a predicate, see tree::erase_if
+ * @param t tree to erase from
+ * @param pred unary predicate on values
+ * @return number of erased nodes
+ */
+template<class T, class... Policies, class Pred>
+typename tree<T, Policies...>::size_type erase_if(tree<T, Policies...> &t, Pred pred){
+    return t.erase_if(pred);
+}
+
+/**
+ * Erases all subtrees with roots matching a predicate, see tree::prune_if
+ * @param t tree to erase from
+ * @param pred unary predicate on values
+ * @return number of erased nodes
+ */
+template<class T, class... Policies, class Pred>
+typename tree<T, Policies...>::size_type prune_if(tree<T, Policies...> &t, Pred pred){
+    return t.prune_if(pred);
+}
+
+//*** node ***
+template<class T, class... Policies>
+tree<T, Policies...>::node::node() {
     parent = nullptr;
     left = right = nullptr;
     child_begin = child_end = nullptr;
 }
 
+//*** node_pool ***
+template<class T, class... Policies>
+tree<T, Policies...>::node_pool::node_pool()
+    :free_list(nullptr), cur(nullptr), cur_end(nullptr), next_size(8)
+{}
+
+template<class T, class... Policies>
+tree<T, Policies...>::node_pool::~node_pool(){
+    for(; cur != cur_end; cur++){
+        cur->next = free_list;
+        free_list = cur;
+    }
+    if(!free_list){
+        return;
+    }
+    auto last = free_list;
+    while(last->next){
+        last = last->next;
+    }
+    auto &shared = p_shared();
+    std::lock_guard<std::mutex> guard(shared.lock);
+    last->next = shared.free_list;
+    shared.free_list = free_list;
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::node_pool::shared_state&
+tree<T, Policies...>::node_pool::p_shared(){
+    static auto result = new shared_state();
+    return *result;
+}
+
+template<class T, class... Policies>
+tree<T, Policies...>::node_pool::thread_guard::~thread_guard(){
+    delete pool;
+    pool = nullptr;
+    exited = true;
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::node_pool&
+tree<T, Policies...>::node_pool::local(){
+    //trivially destructible, so they stay valid until a thread ends
+    thread_local node_pool* result = nullptr;
+    thread_local bool exited = false;
+    if(result){
+        return *result;
+    }
+    if(exited){
+        auto &shared = p_shared();
+        std::lock_guard<std::mutex> guard(shared.lock);
+        shared.late_pools.emplace_back(new node_pool());
+        result = shared.late_pools.back().get();
+    }else{
+        result = new node_pool();
+        thread_local thread_guard guard{result, exited};
+    }
+    return *result;
+}
+
+template<class T, class... Policies>
+void tree<T, Policies...>::node_pool::p_grow(size_t count){
+    //keep blocks under 64KiB unless a bigger chain is requested
+    const size_t max_size = std::max<size_t>(1, (64 << 10) / sizeof(slot));
+    for(; cur != cur_end; cur++){
+        cur->next = free_list;
+        free_list = cur;
+    }
+    auto &shared = p_shared();
+    std::lock_guard<std::mutex> guard(shared.lock);
+    if(count == 1 && shared.free_list){
+        free_list = shared.free_list;
+        shared.free_list = nullptr;
+        return;
+    }
+    auto size = std::max(count, next_size);
+    shared.blocks.emplace_back(new slot[size]);
+    cur = shared.blocks.back().get();
+    cur_end = cur + size;
+    next_size = std::min(next_size * 2, max_size);
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::node* tree<T, Policies...>::node_pool::allocate(){
+    if(!free_list && cur == cur_end){
+        p_grow(1);
+    }
+    slot* s;
+    if(free_list){
+        s = free_list;
+        free_list = s->next;
+    }else{
+        s = cur++;
+    }
+    return new (&s->n) node();
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::node* tree<T, Policies...>::node_pool::allocate(size_t count){
+    static_assert(sizeof(slot) == sizeof(node),
+        "nodes of a block must be addressable as an array");
+    if(count == 1){
+        return allocate();
+    }
+    if(static_cast<size_t>(cur_end - cur) < count){
+        p_grow(count);
+    }
+    auto s = cur;
+    cur += count;
+    for(size_t i = 0; i < count; i++){
+        new (&s[i].n) node();
+    }
+    return &s->n;
+}
+
+template<class T, class... Policies>
+void tree<T, Policies...>::node_pool::reserve(size_t count){
+    if(static_cast<size_t>(cur_end - cur) < count){
+        p_grow(count);
+    }
+}
+
+template<class T, class... Policies>
+void tree<T, Policies...>::node_pool::deallocate(node* n){
+    if(!n){
+        return;
+    }
+    n->~node();
+    auto s = reinterpret_cast<slot*>(n);
+    s->next = free_list;
+    free_list = s;
+}
+
 //*** iterator_base ***
-template<class T>
-tree<T>::iterator_base::iterator_base(node* n) {
+template<class T, class... Policies>
+tree<T, Policies...>::iterator_base::iterator_base(node* n) {
     this->n = n;
 }
 
-template<class T>
-tree<T>::iterator_base::iterator_base(const iterator_base &rhs) {
+template<class T, class... Policies>
+tree<T, Policies...>::iterator_base::iterator_base(const iterator_base &rhs) {
     this->n = rhs.n;
 }
 
-template<class T>
-auto& tree<T>::iterator_base::operator*(){
-    return n->value;
+template<class T, class... Policies>
+T& tree<T, Policies...>::iterator_base::operator*()const{
+    p_on_access(n);
+    return n->value();
 }
 
-template<class T>
-const auto& tree<T>::iterator_base::operator*()const{
-    return n->value;
+template<class T, class... Policies>
+T* tree<T, Policies...>::iterator_base::operator->()const{
+    p_on_access(n);
+    return &n->value();
 }
 
-template<class T>
-bool tree<T>::iterator_base::operator==(const iterator_base &rhs)const{
+template<class T, class... Policies>
+bool tree<T, Policies...>::iterator_base::operator==(const iterator_base &rhs)const{
     return this->n == rhs.n;
 }
 
-template<class T>
-bool tree<T>::iterator_base::operator!=(const iterator_base &rhs)const{
+template<class T, class... Policies>
+bool tree<T, Policies...>::iterator_base::operator!=(const iterator_base &rhs)const{
     return this->n != rhs.n;
 }
 
 //*** depth_first_iterator ***
-template<class T>
-tree<T>::depth_first_iterator::
+template<class T, class... Policies>
+tree<T, Policies...>::depth_first_iterator::
     depth_first_iterator(node* n)
     :iterator_base(n)
 {}
 
-template<class T>
-tree<T>::depth_first_iterator::
+template<class T, class... Policies>
+tree<T, Policies...>::depth_first_iterator::
     depth_first_iterator(const iterator_base &rhs)
     :iterator_base(rhs)
 {}
 
-template<class T>
-typename tree<T>::depth_first_iterator&
-tree<T>::depth_first_iterator::operator++(){
+template<class T, class... Policies>
+typename tree<T, Policies...>::depth_first_iterator&
+tree<T, Policies...>::depth_first_iterator::operator++(){
     if(this->n->child_begin){
         this->n = this->n->child_begin;
     }else{
@@ -538,9 +3032,9 @@ tree<T>::depth_first_iterator::operator++(){
     return *this;
 }
 
-template<class T>
-typename tree<T>::depth_first_iterator&
-tree<T>::depth_first_iterator::operator--(){
+template<class T, class... Policies>
+typename tree<T, Policies...>::depth_first_iterator&
+tree<T, Policies...>::depth_first_iterator::operator--(){
     if(this->n->left){
         this->n = this->n->left;
         while(this->n->child_end){
@@ -552,85 +3046,91 @@ tree<T>::depth_first_iterator::operator--(){
     return *this;
 }
 
-template<class T>
-typename tree<T>::depth_first_iterator
-tree<T>::depth_first_iterator::operator++(int){
+template<class T, class... Policies>
+typename tree<T, Policies...>::depth_first_iterator
+tree<T, Policies...>::depth_first_iterator::operator++(int){
     auto copy = *this;
     ++(*this);
     return copy;
 }
 
-template<class T>
-typename tree<T>::depth_first_iterator
-tree<T>::depth_first_iterator::operator--(int){
+template<class T, class... Policies>
+typename tree<T, Policies...>::depth_first_iterator
+tree<T, Policies...>::depth_first_iterator::operator--(int){
     auto copy = *this;
     --(*this);
     return copy;
 }
 
 //*** depth_first_reverse_iterator ***
-template<class T>
-tree<T>::depth_first_reverse_iterator::
+template<class T, class... Policies>
+tree<T, Policies...>::depth_first_reverse_iterator::
     depth_first_reverse_iterator(node* n)
     :depth_first_iterator(n)
 {}
 
-template<class T>
-tree<T>::depth_first_reverse_iterator::
+template<class T, class... Policies>
+tree<T, Policies...>::depth_first_reverse_iterator::
     depth_first_reverse_iterator(const iterator_base &rhs)
     :depth_first_iterator(rhs)
 {}
 
-template<class T>
-typename tree<T>::depth_first_reverse_iterator&
-tree<T>::depth_first_reverse_iterator::operator++(){
-    return depth_first_iterator::operator--();
+template<class T, class... Policies>
+typename tree<T, Policies...>::depth_first_reverse_iterator&
+tree<T, Policies...>::depth_first_reverse_iterator::operator++(){
+    depth_first_iterator::operator--();
+    return *this;
 }
 
-template<class T>
-typename tree<T>::depth_first_reverse_iterator&
-tree<T>::depth_first_reverse_iterator::operator--(){
-    return depth_first_iterator::operator++();
+template<class T, class... Policies>
+typename tree<T, Policies...>::depth_first_reverse_iterator&
+tree<T, Policies...>::depth_first_reverse_iterator::operator--(){
+    depth_first_iterator::operator++();
+    return *this;
 }
 
-template<class T>
-typename tree<T>::depth_first_reverse_iterator
-tree<T>::depth_first_reverse_iterator::operator++(int){
+template<class T, class... Policies>
+typename tree<T, Policies...>::depth_first_reverse_iterator
+tree<T, Policies...>::depth_first_reverse_iterator::operator++(int){
     auto copy = *this;
     ++(*this);
     return copy;
 }
 
-template<class T>
-typename tree<T>::depth_first_reverse_iterator
-tree<T>::depth_first_reverse_iterator::operator--(int){
+template<class T, class... Policies>
+typename tree<T, Policies...>::depth_first_reverse_iterator
+tree<T, Policies...>::depth_first_reverse_iterator::operator--(int){
     auto copy = *this;
     --(*this);
     return copy;
 }
 
 /*** breadth_first_iterator ***/
-template<class T>
-tree<T>::breadth_first_iterator::
+template<class T, class... Policies>
+tree<T, Policies...>::breadth_first_iterator::
     breadth_first_iterator(node* n)
     :iterator_base(n)
 {
-    q.emplace(n);
+    if(n){
+        q.emplace(n);
+    }
 }
 
-template<class T>
-tree<T>::breadth_first_iterator::
+template<class T, class... Policies>
+tree<T, Policies...>::breadth_first_iterator::
     breadth_first_iterator(const iterator_base &rhs)
     :iterator_base(rhs)
 {
-    q.emplace(rhs.n);
+    if(rhs.n){
+        q.emplace(rhs.n);
+    }
 }
 
-template<class T>
-typename tree<T>::breadth_first_iterator&
-tree<T>::breadth_first_iterator::operator++(){
+template<class T, class... Policies>
+typename tree<T, Policies...>::breadth_first_iterator&
+tree<T, Policies...>::breadth_first_iterator::operator++(){
     if(this->n->right){
-        if(this->n->parent && this->n->right){//it's not foot
+        if(this->n->parent || this->n->right->right){//it's not foot
             this->n = this->n->right;
             q.emplace(this->n);
             return *this;
@@ -653,130 +3153,693 @@ tree<T>::breadth_first_iterator::operator++(){
     return *this;
 }
 
-template<class T>
-typename tree<T>::breadth_first_iterator
-tree<T>::breadth_first_iterator::operator++(int){
+template<class T, class... Policies>
+typename tree<T, Policies...>::breadth_first_iterator
+tree<T, Policies...>::breadth_first_iterator::operator++(int){
+    auto copy = *this;
+    ++(*this);
+    return copy;
+}
+
+/*** post_order_iterator ***/
+template<class T, class... Policies>
+tree<T, Policies...>::post_order_iterator::
+    post_order_iterator(node* n)
+    :iterator_base(n)
+{}
+
+template<class T, class... Policies>
+tree<T, Policies...>::post_order_iterator::
+    post_order_iterator(const iterator_base &rhs)
+    :iterator_base(rhs)
+{}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::post_order_iterator&
+tree<T, Policies...>::post_order_iterator::operator++(){
+    if(this->n->right){
+        this->n = this->n->right;
+        while(this->n->child_begin){
+            this->n = this->n->child_begin;
+        }
+    }else{
+        this->n = this->n->parent;
+    }
+    return *this;
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::post_order_iterator&
+tree<T, Policies...>::post_order_iterator::operator--(){
+    if(this->n->child_end){
+        this->n = this->n->child_end;
+    }else{
+        while(!this->n->left){
+            this->n = this->n->parent;
+            if(!this->n){
+                return *this;
+            }
+        }
+        this->n = this->n->left;
+    }
+    return *this;
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::post_order_iterator
+tree<T, Policies...>::post_order_iterator::operator++(int){
+    auto copy = *this;
+    ++(*this);
+    return copy;
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::post_order_iterator
+tree<T, Policies...>::post_order_iterator::operator--(int){
+    auto copy = *this;
+    --(*this);
+    return copy;
+}
+
+/*** leaf_iterator ***/
+template<class T, class... Policies>
+tree<T, Policies...>::leaf_iterator::
+    leaf_iterator(node* n)
+    :iterator_base(n)
+{}
+
+template<class T, class... Policies>
+tree<T, Policies...>::leaf_iterator::
+    leaf_iterator(const iterator_base &rhs)
+    :iterator_base(rhs)
+{}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::leaf_iterator&
+tree<T, Policies...>::leaf_iterator::operator++(){
+    while(!this->n->right){
+        this->n = this->n->parent;
+        if(!this->n){
+            return *this;
+        }
+    }
+    this->n = this->n->right;
+    while(this->n->child_begin){
+        this->n = this->n->child_begin;
+    }
+    return *this;
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::leaf_iterator&
+tree<T, Policies...>::leaf_iterator::operator--(){
+    while(!this->n->left){
+        this->n = this->n->parent;
+        if(!this->n){
+            return *this;
+        }
+    }
+    this->n = this->n->left;
+    while(this->n->child_end){
+        this->n = this->n->child_end;
+    }
+    return *this;
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::leaf_iterator
+tree<T, Policies...>::leaf_iterator::operator++(int){
+    auto copy = *this;
+    ++(*this);
+    return copy;
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::leaf_iterator
+tree<T, Policies...>::leaf_iterator::operator--(int){
+    auto copy = *this;
+    --(*this);
+    return copy;
+}
+
+/*** sibling_iterator ***/
+template<class T, class... Policies>
+tree<T, Policies...>::sibling_iterator::
+    sibling_iterator(node* n, node* parent)
+    :iterator_base(n), parent(n? n->parent : parent)
+{}
+
+template<class T, class... Policies>
+tree<T, Policies...>::sibling_iterator::
+    sibling_iterator(const iterator_base &rhs)
+    :iterator_base(rhs), parent(rhs.n? rhs.n->parent : nullptr)
+{}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::sibling_iterator&
+tree<T, Policies...>::sibling_iterator::operator++(){
+    this->n = this->n->right;
+    return *this;
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::sibling_iterator&
+tree<T, Policies...>::sibling_iterator::operator--(){
+    this->n = this->n? this->n->left : parent->child_end;
+    return *this;
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::sibling_iterator
+tree<T, Policies...>::sibling_iterator::operator++(int){
     auto copy = *this;
     ++(*this);
     return copy;
 }
 
+template<class T, class... Policies>
+typename tree<T, Policies...>::sibling_iterator
+tree<T, Policies...>::sibling_iterator::operator--(int){
+    auto copy = *this;
+    --(*this);
+    return copy;
+}
+
 /*** tree ***/
-template<class T>
-tree<T>::tree(T&& val)
+template<class T, class... Policies>
+tree<T, Policies...>::tree(T&& val)
     :tree()
 {
     set_root(std::forward<T>(val));
 }
 
-template<class T>
-tree<T>::tree(const tree<T> &rhs)
+template<class T, class... Policies>
+tree<T, Policies...>::tree(const tree<T, Policies...> &rhs)
     :tree()
 {
     p_transfer(rhs);
 }
 
-template<class T>
-tree<T>::tree(tree<T> &&rhs) {
-    this->root = rhs.root;
-    this->foot = rhs.foot;
-    rhs.root = nullptr;
-    rhs.foot = nullptr;
+template<class T, class... Policies>
+tree<T, Policies...>::tree(tree<T, Policies...> &&rhs)
+    :tree()
+{
+    p_take(rhs);
 }
 
-template<class T>
-tree<T>::tree(){
+template<class T, class... Policies>
+tree<T, Policies...>::tree(){
     p_init();
 }
 
-template<class T>
-tree<T>::~tree(){
-    p_erase_children(root, foot);
+template<class T, class... Policies>
+tree<T, Policies...>::~tree(){
+    p_release_all();
 }
 
-template<class T>
-tree<T>& tree<T>::operator=(const tree<T> &rhs){
+template<class T, class... Policies>
+tree<T, Policies...>& tree<T, Policies...>::operator=(const tree<T, Policies...> &rhs){
     clear();
     p_transfer(rhs);
     return *this;
 }
 
-template<class T>
-tree<T>& tree<T>::operator=(tree<T> &&rhs){
-    p_erase_children(root, foot);
-    this->root = rhs.root;
-    this->foot = rhs.foot;
-    rhs.root = nullptr;
-    rhs.foot = nullptr;
+template<class T, class... Policies>
+tree<T, Policies...>& tree<T, Policies...>::operator=(tree<T, Policies...> &&rhs){
+    if(this != &rhs){
+        p_release_all();
+        p_take(rhs);
+    }
     return *this;
 }
 
-template<class T>
-bool tree<T>::empty()const{
+template<class T, class... Policies>
+bool tree<T, Policies...>::empty()const{
     return this->root == this->foot;
 }
 
-template<class T>
-void tree<T>::clear(){
-    if(root == foot){
+template<class T, class... Policies>
+void tree<T, Policies...>::clear(){
+    if(empty()){
         return;
     }
-    erase(depth_first_iterator(root));
+    p_release_all();
+    root = foot;
+    foot->left = nullptr;
+    p_on_rebuild(nullptr);
 }
 
-template<class T> template<class It>
-It tree<T>::erase(const It &it){
+template<class T, class... Policies> template<class It>
+It tree<T, Policies...>::erase(const It &it){
     assert(it.n != foot);
-    if(it.n->child_begin){
-        p_erase_children(it.n->child_begin, it.n->child_end);
-    }
+    p_on_unlink(it.n);
     It bak = (it.n->right)?
         It(it.n->right):
         It(it.n->parent);
-    if(it.n->left){
-        it.n->left->right = it.n->right;
+    p_unlink(it.n);
+    p_release_subtree(it.n);
+    return bak;
+}
+
+template<class T, class... Policies> template<class Pred>
+typename tree<T, Policies...>::size_type
+tree<T, Policies...>::erase_if(Pred pred){
+    size_type result = 0;
+    for(auto n = root; n != foot;){
+        if(!pred(n->value())){
+            n = n->child_begin? n->child_begin : p_skip_subtree(n);
+            continue;
+        }
+        node* next;
+        p_unlink(n);
+        if(n->child_begin){
+            for(auto c = n->child_begin; c; c = c->right){
+                c->parent = n->parent;
+            }
+            next = n->child_begin;
+            p_splice(n->parent, n->left, n->right, {n->child_begin, n->child_end});
+        }else{
+            next = p_skip_subtree(n);
+        }
+        p_delete_node(n);
+        result++;
+        n = next;
     }
-    if(it.n->right){
-        it.n->right->left = it.n->left;
+    if(result){
+        p_on_rebuild(nullptr);
     }
-    if(it.n->parent){
-        if(it.n->parent->child_begin == it.n){
-            it.n->parent->child_begin = it.n->right;
+    return result;
+}
+
+template<class T, class... Policies> template<class Pred>
+typename tree<T, Policies...>::size_type
+tree<T, Policies...>::prune_if(Pred pred){
+    size_type result = 0;
+    for(auto n = root; n != foot;){
+        if(!pred(n->value())){
+            n = n->child_begin? n->child_begin : p_skip_subtree(n);
+            continue;
         }
-        if(it.n->parent->child_end == it.n){
-            it.n->parent->child_end = it.n->left;
+        auto next = p_skip_subtree(n);
+        p_unlink(n);
+        result += p_release_subtree(n);
+        n = next;
+    }
+    if(result){
+        p_on_rebuild(nullptr);
+    }
+    return result;
+}
+
+template<class T, class... Policies>
+void tree<T, Policies...>::reserve(size_type n){
+    pool().reserve(n);
+    if constexpr(p_separated){
+        this->p_values.reserve(this->p_values.size() + n);
+    }
+}
+
+template<class T, class... Policies>
+void tree<T, Policies...>::compact(){
+    if(empty()){
+        return;
+    }
+    const auto count = size();
+    auto nodes = pool().allocate(count);
+    node* parent = nullptr; //copy of parent of src
+    node* prev = nullptr; //last copied sibling of src
+    auto src = root;
+    for(auto tmp = nodes; src != foot; tmp++){
+        if constexpr(p_separated){
+            tmp->ptr = src->ptr;
+            src->ptr = nullptr;
+        }else{
+            tmp->value() = std::move(src->value());
+        }
+        p_move_data(tmp, src);
+        tmp->parent = parent;
+        tmp->left = prev;
+        if(prev){
+            prev->right = tmp;
+        }else if(parent){
+            parent->child_begin = tmp;
+        }
+        if(parent){
+            parent->child_end = tmp;
+        }
+        if(src->child_begin){
+            parent = tmp;
+            prev = nullptr;
+            src = src->child_begin;
+            continue;
         }
+        prev = tmp;
+        while(!src->right){
+            src = src->parent;
+            prev = parent;
+            parent = parent->parent;
+        }
+        src = src->right;
     }
-    if(it.n == root){
-        root = foot;
+    prev->right = foot;
+    foot->left = prev;
+    if constexpr(p_separated){
+        //values follow nodes in depth-first order too
+        this->p_values.reorder(count, [nodes](size_t i)->T*&{
+            return nodes[i].ptr;
+        });
     }
-    delete it.n;
-    return bak;
+    p_release_all();
+    root = nodes;
+    p_on_rebuild(nullptr);
+}
+
+template<class T, class... Policies> template<class Parents, class Values>
+tree<T, Policies...> tree<T, Policies...>::from_parent_array(const Parents &parents, Values &&values,
+    size_type threads)
+{
+    tree result;
+    const size_type count = parents.size();
+    assert(values.size() == count);
+    if(!count){
+        return result;
+    }
+    if(!threads){
+        threads = (count < parallel_threshold)? 1 : std::max(1u, std::thread::hardware_concurrency());
+    }
+    //bucket 0 holds top level, bucket p + 1 holds children of p
+    auto bucket = [&parents](size_type i){
+        auto p = static_cast<size_type>(parents[i]);
+        return (p == npos)? 0 : p + 1;
+    };
+    const size_type buckets = count + 1;
+    //indices are split stably into contiguous ranges of buckets, one per
+    //part, then each part counting-sorts its range of buckets alone
+    const size_type parts = threads;
+    auto part_begin = [count, parts](size_type p){
+        return count / parts * p + std::min(p, count % parts);
+    };
+    auto range_of = [buckets, parts](size_type b){
+        return b * parts / buckets;
+    };
+    auto range_begin = [buckets, parts](size_type r){
+        return (r * buckets + parts - 1) / parts;
+    };
+    //cursor of part p of indices in range r is at r * parts + p
+    std::vector<size_type> spread(parts * parts);
+    auto nodes = result.p_new_nodes(count);
+    p_parallel_for(parts, threads, [&](size_t first, size_t last){
+        for(auto p = first; p < last; p++){
+            for(auto i = part_begin(p); i < part_begin(p + 1); i++){
+                assert(parents[i] == npos || static_cast<size_type>(parents[i]) < count);
+                spread[range_of(bucket(i)) * parts + p]++;
+                if constexpr(std::is_lvalue_reference<Values>::value){
+                    nodes[i].value() = values[i];
+                }else{
+                    nodes[i].value() = std::move(values[i]);
+                }
+            }
+        }
+    }, 1);
+    size_type offset = 0;
+    for(auto &cursor:spread){
+        auto size = cursor;
+        cursor = offset;
+        offset += size;
+    }
+    std::vector<size_type> by_range(count);
+    p_parallel_for(parts, threads, [&](size_t first, size_t last){
+        for(auto p = first; p < last; p++){
+            for(auto i = part_begin(p); i < part_begin(p + 1); i++){
+                by_range[spread[range_of(bucket(i)) * parts + p]++] = i;
+            }
+        }
+    }, 1);
+    //a range of buckets takes the same place in by_range and in order
+    std::vector<size_type> begins(buckets + 1), cursors(buckets), order(count);
+    p_parallel_for(parts, threads, [&](size_t first, size_t last){
+        for(auto r = first; r < last; r++){
+            auto from = by_range.begin() + (r? spread[r * parts - 1] : 0);
+            auto to = by_range.begin() + spread[r * parts + parts - 1];
+            for(auto it = from; it != to; ++it){
+                cursors[bucket(*it)]++;
+            }
+            auto cursor = static_cast<size_type>(from - by_range.begin());
+            for(auto b = range_begin(r); b < range_begin(r + 1); b++){
+                auto size = cursors[b];
+                begins[b] = cursors[b] = cursor;
+                cursor += size;
+            }
+            for(auto it = from; it != to; ++it){
+                order[cursors[bucket(*it)]++] = *it;
+            }
+        }
+    }, 1);
+    begins[buckets] = count;
+    assert(begins[1] > 0 && "parents must have at least one top level node");
+    p_parallel_for(buckets, threads, [&](size_t first, size_t last){
+        for(auto b = first; b < last; b++){
+            auto beg = order.begin() + begins[b], end = order.begin() + begins[b + 1];
+            if(beg == end){
+                continue;
+            }
+            node* parent = b? nodes + (b - 1) : nullptr;
+            node* prev = nullptr;
+            for(auto it = beg; it != end; ++it){
+                auto n = nodes + *it;
+                n->parent = parent;
+                n->left = prev;
+                if(prev){
+                    prev->right = n;
+                }
+                prev = n;
+            }
+            if(parent){
+                parent->child_begin = nodes + *beg;
+                parent->child_end = prev;
+            }
+        }
+    });
+    auto last = nodes + order[begins[1] - 1];
+    result.root = nodes + order[0];
+    last->right = result.foot;
+    result.foot->left = last;
+    result.p_on_rebuild(nullptr);
+    return result;
+}
+
+template<class T, class... Policies> template<class IndexOut, class ValueOut>
+std::pair<IndexOut, ValueOut> tree<T, Policies...>::to_parent_array(IndexOut parents, ValueOut values)const{
+    std::vector<size_type> path; //indices of parents of a current node
+    size_type index = 0;
+    for(auto n = root; n != foot; index++){
+        *parents++ = path.empty()? npos : path.back();
+        *values++ = n->value();
+        if(n->child_begin){
+            path.emplace_back(index);
+            n = n->child_begin;
+            continue;
+        }
+        while(!n->right){
+            n = n->parent;
+            path.pop_back();
+        }
+        n = n->right;
+    }
+    return {parents, values};
 }
 
-template<class T> template<class X, class It>
-It tree<T>::set_root(X&& val){
+template<class T, class... Policies> template<class X, class It>
+It tree<T, Policies...>::set_root(X&& val){
     if(root == foot){
-        foot = new node();
+        root = p_new_node();
         root->right = foot;
         foot->left = root;
+        this->root->value() = std::forward<X>(val);
+        p_on_link(root, root);
+    }else{
+        this->root->value() = std::forward<X>(val);
+        p_on_modify(root);
     }
-    this->root->value = std::forward<X>(val);
     return It(this->root);
 }
 
-template<class T> template<class It>
-It tree<T>::begin()const{
+template<class T, class... Policies> template<class It>
+It tree<T, Policies...>::begin(){
+    return It(this->root);
+}
+
+template<class T, class... Policies> template<class It>
+auto tree<T, Policies...>::begin()const
+    ->basic_const_iterator<It>
+{
     return It(this->root);
 }
 
-template<class T> template<class It>
-It tree<T>::end()const{
+template<class T, class... Policies> template<class It>
+It tree<T, Policies...>::end(){
     return It(this->foot);
 }
 
-template<class T>
-typename tree<T>::size_type tree<T>::size()const{
+template<class T, class... Policies> template<class It>
+auto tree<T, Policies...>::end()const
+    ->basic_const_iterator<It>
+{
+    return It(this->foot);
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::post_order_iterator
+tree<T, Policies...>::begin_post()const{
+    auto n = this->root;
+    while(n->child_begin){
+        n = n->child_begin;
+    }
+    return post_order_iterator(n);
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::post_order_iterator
+tree<T, Policies...>::end_post()const{
+    return post_order_iterator(this->foot);
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::leaf_iterator
+tree<T, Policies...>::begin_leaf()const{
+    auto n = this->root;
+    while(n->child_begin){
+        n = n->child_begin;
+    }
+    return leaf_iterator(n);
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::leaf_iterator
+tree<T, Policies...>::end_leaf()const{
+    return leaf_iterator(this->foot);
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::const_iterator
+tree<T, Policies...>::cbegin()const{
+    return const_iterator(this->root);
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::const_iterator
+tree<T, Policies...>::cend()const{
+    return const_iterator(this->foot);
+}
+
+template<class T, class... Policies>
+auto tree<T, Policies...>::children(const iterator_base &it)
+    ->range<sibling_iterator>
+{
+    return range<sibling_iterator>(
+        sibling_iterator(it.n->child_begin, it.n),
+        sibling_iterator(nullptr, it.n));
+}
+
+template<class T, class... Policies>
+auto tree<T, Policies...>::children(const iterator_base &it)const
+    ->range<const_sibling_iterator>
+{
+    return range<const_sibling_iterator>(
+        sibling_iterator(it.n->child_begin, it.n),
+        sibling_iterator(nullptr, it.n));
+}
+
+template<class T, class... Policies> template<class It, class OutIt>
+OutIt tree<T, Policies...>::path_to_root(const It &it, OutIt out){
+    for(auto n = it.n; n; n = n->parent){
+        *out++ = It(n);
+    }
+    return out;
+}
+
+template<class T, class... Policies>
+auto tree<T, Policies...>::dfs()
+    ->range<depth_first_iterator>
+{
+    return range<depth_first_iterator>(begin(), end());
+}
+
+template<class T, class... Policies>
+auto tree<T, Policies...>::dfs()const
+    ->range<const_depth_first_iterator>
+{
+    return range<const_depth_first_iterator>(cbegin(), cend());
+}
+
+template<class T, class... Policies>
+auto tree<T, Policies...>::bfs()
+    ->range<breadth_first_iterator>
+{
+    return range<breadth_first_iterator>(
+        begin<breadth_first_iterator>(), end<breadth_first_iterator>());
+}
+
+template<class T, class... Policies>
+auto tree<T, Policies...>::bfs()const
+    ->range<const_breadth_first_iterator>
+{
+    return range<const_breadth_first_iterator>(
+        begin<breadth_first_iterator>(), end<breadth_first_iterator>());
+}
+
+template<class T, class... Policies>
+auto tree<T, Policies...>::post_order()
+    ->range<post_order_iterator>
+{
+    return range<post_order_iterator>(begin_post(), end_post());
+}
+
+template<class T, class... Policies>
+auto tree<T, Policies...>::post_order()const
+    ->range<const_post_order_iterator>
+{
+    return range<const_post_order_iterator>(begin_post(), end_post());
+}
+
+template<class T, class... Policies>
+auto tree<T, Policies...>::leaves()
+    ->range<leaf_iterator>
+{
+    return range<leaf_iterator>(begin_leaf(), end_leaf());
+}
+
+template<class T, class... Policies>
+auto tree<T, Policies...>::leaves()const
+    ->range<const_leaf_iterator>
+{
+    return range<const_leaf_iterator>(begin_leaf(), end_leaf());
+}
+
+template<class T, class... Policies>
+auto tree<T, Policies...>::freeze()
+    ->frozen_range
+{
+    std::vector<node*> nodes;
+    for(auto it = begin(); it != end(); it++){
+        nodes.emplace_back(it.n);
+    }
+    return frozen_range(std::move(nodes));
+}
+
+template<class T, class... Policies>
+auto tree<T, Policies...>::freeze()const
+    ->const_frozen_range
+{
+    std::vector<node*> nodes;
+    for(auto it = begin(); it != end(); it++){
+        nodes.emplace_back(it.n);
+    }
+    return const_frozen_range(std::move(nodes));
+}
+
+template<class T, class... Policies>
+typename tree<T, Policies...>::size_type tree<T, Policies...>::size()const{
      decltype(this->size()) result=0;
      auto it = begin();
      while(it != end()){
@@ -786,9 +3849,9 @@ typename tree<T>::size_type tree<T>::size()const{
      return result;
 }
 
-template<class T> template<class It, class X>
-It tree<T>::insert_left(It& it, X&& val){
-    auto tmp = new node();
+template<class T, class... Policies> template<class It, class X>
+It tree<T, Policies...>::insert_left(It& it, X&& val){
+    auto tmp = p_new_node();
     if(it.n->left){
         tmp->left = it.n->left;
         tmp->right = it.n;
@@ -807,13 +3870,14 @@ It tree<T>::insert_left(It& it, X&& val){
             it.n->parent->child_begin = tmp;
         }
     }
-    tmp->value = std::forward<X>(val);
+    tmp->value() = std::forward<X>(val);
+    p_on_link(tmp, tmp);
     return It(tmp);
 }
 
-template<class T> template<class It, class X>
-It tree<T>::insert_right(It& it, X&& val){
-    auto tmp = new node();
+template<class T, class... Policies> template<class It, class X>
+It tree<T, Policies...>::insert_right(It& it, X&& val){
+    auto tmp = p_new_node();
     if(it.n->right){
         tmp->right = it.n->right;
         tmp->left = it.n;
@@ -829,27 +3893,45 @@ It tree<T>::insert_right(It& it, X&& val){
             it.n->parent->child_end = tmp;
         }
     }
-    tmp->value = std::forward<X>(val);
+    tmp->value() = std::forward<X>(val);
+    p_on_link(tmp, tmp);
     return It(tmp);
 }
 
-template<class T> template<class It, class X>
-It tree<T>::append_child(It& it, X&& val){
+template<class T, class... Policies> template<class It, class X>
+It tree<T, Policies...>::append_child(It& it, X&& val){
     if(!it.n->child_end){ //iterator has no children
         return prepend_child(it, std::forward<X>(val));
     }
-    auto tmp = new node();
+    auto tmp = p_new_node();
     tmp->parent = it.n;
     tmp->left = it.n->child_end;
     it.n->child_end->right = tmp;
     it.n->child_end = tmp;
-    tmp->value = std::forward<X>(val);
+    tmp->value() = std::forward<X>(val);
+    p_on_link(tmp, tmp);
+    return It(tmp);
+}
+
+template<class T, class... Policies> template<class It, class X>
+It tree<T, Policies...>::concurrent_append_child(const It& it, X&& val){
+    static_assert(sizeof...(Policies) == 0,
+        "policies are not notified about concurrent inserts");
+    auto tmp = p_new_node();
+    tmp->parent = it.n;
+    tmp->value() = std::forward<X>(val);
+    auto tail = p_atomic_load(it.n->child_end);
+    do{
+        tmp->left = tail;
+    }while(!p_atomic_cas(it.n->child_end, tail, tmp));
+    //only the thread that took a place after tail links to it
+    p_atomic_store(tail? tail->right : it.n->child_begin, tmp);
     return It(tmp);
 }
 
-template<class T> template<class It, class X>
-It tree<T>::prepend_child(It& it, X&& val){
-    auto tmp = new node();
+template<class T, class... Policies> template<class It, class X>
+It tree<T, Policies...>::prepend_child(It& it, X&& val){
+    auto tmp = p_new_node();
     tmp->parent = it.n;
     if(!it.n->child_begin){
         it.n->child_begin = tmp;
@@ -859,13 +3941,144 @@ It tree<T>::prepend_child(It& it, X&& val){
         tmp->right = it.n->child_begin;
         it.n->child_begin = tmp;
     }
-    tmp->value = std::forward<X>(val);
+    tmp->value() = std::forward<X>(val);
+    p_on_link(tmp, tmp);
     return It(tmp);
 }
 
-template<class T>
-bool tree<T>::operator==(const tree<T> &rhs)const{
+template<class T, class... Policies> template<class It, class X>
+void tree<T, Policies...>::replace(const It& it, X&& val){
+    it.n->value() = std::forward<X>(val);
+    p_on_modify(it.n);
+}
+
+template<class T, class... Policies> template<class It, class Fn>
+void tree<T, Policies...>::modify(const It& it, Fn fn){
+    fn(it.n->value());
+    p_on_modify(it.n);
+}
+
+template<class T, class... Policies> template<class It, class InputIt>
+It tree<T, Policies...>::append_children(It& it, InputIt first, InputIt last){
+    auto chain = p_make_chain(first, last, it.n);
+    if(!chain.first){
+        return It(foot);
+    }
+    p_splice(it.n, it.n->child_end, nullptr, chain);
+    p_on_link(chain.first, chain.second);
+    return It(chain.first);
+}
+
+template<class T, class... Policies> template<class It, class InputIt>
+It tree<T, Policies...>::prepend_children(It& it, InputIt first, InputIt last){
+    auto chain = p_make_chain(first, last, it.n);
+    if(!chain.first){
+        return It(foot);
+    }
+    p_splice(it.n, nullptr, it.n->child_begin, chain);
+    p_on_link(chain.first, chain.second);
+    return It(chain.first);
+}
+
+template<class T, class... Policies> template<class It, class InputIt>
+It tree<T, Policies...>::insert_range_left(It& it, InputIt first, InputIt last){
+    auto chain = p_make_chain(first, last, it.n->parent);
+    if(!chain.first){
+        return It(foot);
+    }
+    p_splice(it.n->parent, it.n->left, it.n, chain);
+    p_on_link(chain.first, chain.second);
+    return It(chain.first);
+}
+
+template<class T, class... Policies> template<class It, class InputIt>
+It tree<T, Policies...>::insert_range_right(It& it, InputIt first, InputIt last){
+    auto chain = p_make_chain(first, last, it.n->parent);
+    if(!chain.first){
+        return It(foot);
+    }
+    p_splice(it.n->parent, it.n, it.n->right, chain);
+    p_on_link(chain.first, chain.second);
+    return It(chain.first);
+}
+
+template<class T, class... Policies> template<class It>
+It tree<T, Policies...>::move_left(const It& it, const It& pos){
+    if(it.n == pos.n || it.n->right == pos.n){
+        return it;
+    }
+    assert(it.n != foot && !p_is_ancestor(it.n, pos.n));
+    p_on_unlink(it.n);
+    p_unlink(it.n);
+    it.n->parent = pos.n->parent;
+    p_splice(pos.n->parent, pos.n->left, pos.n, {it.n, it.n});
+    p_on_link(it.n, it.n);
+    return it;
+}
+
+template<class T, class... Policies> template<class It>
+It tree<T, Policies...>::move_right(const It& it, const It& pos){
+    if(it.n == pos.n || it.n->left == pos.n){
+        return it;
+    }
+    assert(it.n != foot && pos.n != foot && !p_is_ancestor(it.n, pos.n));
+    p_on_unlink(it.n);
+    p_unlink(it.n);
+    it.n->parent = pos.n->parent;
+    p_splice(pos.n->parent, pos.n, pos.n->right, {it.n, it.n});
+    p_on_link(it.n, it.n);
+    return it;
+}
+
+template<class T, class... Policies> template<class It, class Compare>
+void tree<T, Policies...>::sort_children(const It& it, Compare cmp){
+    p_sort_children(it.n, cmp);
+    p_on_reorder(it.n);
+}
+
+template<class T, class... Policies> template<class It, class Compare>
+void tree<T, Policies...>::sort_subtree(const It& it, Compare cmp){
+    const size_type threads = std::thread::hardware_concurrency();
+    if(threads < 2 || p_count(it.n, parallel_threshold) < parallel_threshold){
+        p_sort_subtree(it.n, cmp);
+        p_on_rebuild(it.n);
+        return;
+    }
+    //subtrees of children are independent, split them between threads
+    std::vector<node*> jobs = {it.n};
+    while(jobs.size() == 1){
+        auto n = jobs.back();
+        jobs.pop_back();
+        p_sort_children(n, cmp);
+        for(n = n->child_begin; n; n = n->right){
+            if(n->child_begin){
+                jobs.emplace_back(n);
+            }
+        }
+    }
+    std::atomic<size_t> next(0);
+    auto worker = [&jobs, &next, cmp]()mutable{
+        for(auto i = next++; i < jobs.size(); i = next++){
+            p_sort_subtree(jobs[i], cmp);
+        }
+    };
+    std::vector<std::thread> workers;
+    for(size_type i = 1; i < std::min<size_type>(threads, jobs.size()); i++){
+        workers.emplace_back(worker);
+    }
+    worker();
+    for(auto &w:workers){
+        w.join();
+    }
+    p_on_rebuild(it.n);
+}
+
+template<class T, class... Policies>
+bool tree<T, Policies...>::operator==(const tree<T, Policies...> &rhs)const{
     using namespace algo;
+    if(!(true && ... && Policies::may_equal(*this, rhs))){
+        return false;
+    }
     auto this_it = begin();
     auto this_it_bak = this_it;
     auto it = rhs.begin();
@@ -874,7 +4087,7 @@ bool tree<T>::operator==(const tree<T> &rhs)const{
         if(this_it == end()){
             return false;
         }
-        if(*it != *this_it){
+        if(it.n->value() != this_it.n->value()){
             return false;
         }
         if(is_parent_to(it, it_bak) != is_parent_to(this_it, this_it_bak)||
@@ -894,11 +4107,306 @@ bool tree<T>::operator==(const tree<T> &rhs)const{
     return true;
 }
 
-template<class T>
-bool tree<T>::operator!=(const tree<T> &rhs)const{
+template<class T, class... Policies>
+bool tree<T, Policies...>::operator!=(const tree<T, Policies...> &rhs)const{
     return !(*this == rhs);
 }
 
+/*** diff ***/
+template<class Hash, class T, class... Policies>
+patch<T> diff(const tree<T, Policies...> &lhs, const tree<T, Policies...> &rhs){
+    using node_ptr = decltype(lhs.begin().n);
+    using kind = typename edit<T>::kind;
+    //hashes of all subtrees, computed bottom-up
+    std::unordered_map<node_ptr, std::uint64_t> hashes;
+    auto hash_tree = [&hashes](const tree<T, Policies...> &t){
+        if(t.empty()){
+            return;
+        }
+        auto n = t.begin().n, foot = t.end().n;
+        while(n->child_begin){
+            n = n->child_begin;
+        }
+        while(true){
+            auto h = algo::hash_mix(Hash()(n->value()));
+            for(auto c = n->child_begin; c; c = c->right){
+                h = algo::hash_mix(h * 0xff51afd7ed558ccdull + hashes[c]);
+            }
+            hashes[n] = h;
+            if(n->right == foot){
+                return;
+            }
+            if(n->right){
+                n = n->right;
+                while(n->child_begin){
+                    n = n->child_begin;
+                }
+            }else{
+                n = n->parent;
+            }
+        }
+    };
+    hash_tree(lhs);
+    hash_tree(rhs);
+    //subtrees with equal hashes and equal values in the same shape
+    auto same = [&hashes](node_ptr x, node_ptr y){
+        if(hashes[x] != hashes[y]){
+            return false;
+        }
+        for(auto top = x;;){
+            if(!(x->value() == y->value()) || !x->child_begin != !y->child_begin){
+                return false;
+            }
+            if(x->child_begin){
+                x = x->child_begin;
+                y = y->child_begin;
+                continue;
+            }
+            while(x != top && !x->right){
+                if(y->right){
+                    return false;
+                }
+                x = x->parent;
+                y = y->parent;
+            }
+            if(x == top){
+                return true;
+            }
+            if(!y->right){
+                return false;
+            }
+            x = x->right;
+            y = y->right;
+        }
+    };
+    auto children = [](const tree<T, Policies...> &t, node_ptr n,
+        std::vector<node_ptr> &result)
+    {
+        result.clear();
+        auto foot = t.end().n;
+        for(auto c = n? n->child_begin : t.begin().n; c && c != foot; c = c->right){
+            result.emplace_back(c);
+        }
+    };
+    patch<T> result;
+    //inserts subtree of rhs in depth-first order
+    auto insert_subtree = [&result](node_ptr top, std::vector<size_t> path){
+        auto n = top;
+        while(true){
+            result.push_back({kind::insert, path, 0, n->value()});
+            if(n->child_begin){
+                n = n->child_begin;
+                path.emplace_back(0);
+                continue;
+            }
+            while(n != top && !n->right){
+                n = n->parent;
+                path.pop_back();
+            }
+            if(n == top){
+                return;
+            }
+            n = n->right;
+            path.back()++;
+        }
+    };
+    struct job{
+        node_ptr l, r; //matched nodes, nullptr for top level
+        std::vector<size_t> path;
+    };
+    std::vector<job> jobs = {{nullptr, nullptr, {}}};
+    std::vector<node_ptr> a, b;
+    while(!jobs.empty()){
+        auto j = std::move(jobs.back());
+        jobs.pop_back();
+        if(j.l && !(j.l->value() == j.r->value())){
+            result.push_back({kind::update, j.path, 0, j.r->value()});
+        }
+        children(lhs, j.l, a);
+        children(rhs, j.r, b);
+        auto path = [&j](size_t i){
+            auto p = j.path;
+            p.emplace_back(i);
+            return p;
+        };
+        //identical prefix and suffix stay in place
+        size_t pre = 0, a_end = a.size(), b_end = b.size();
+        while(pre < a_end && pre < b_end && same(a[pre], b[pre])){
+            pre++;
+        }
+        while(a_end > pre && b_end > pre && same(a[a_end - 1], b[b_end - 1])){
+            a_end--;
+            b_end--;
+        }
+        //match identical subtrees, then pair the rest by position
+        const size_t none = -1;
+        std::unordered_multimap<std::uint64_t, size_t> by_hash;
+        for(size_t i = pre; i < a_end; i++){
+            by_hash.emplace(hashes[a[i]], i);
+        }
+        std::vector<size_t> match(b_end, none);
+        std::vector<bool> used(a_end, false), identical(b_end, false);
+        for(size_t k = pre; k < b_end; k++){
+            auto range = by_hash.equal_range(hashes[b[k]]);
+            auto found = std::find_if(range.first, range.second,
+                [&](const std::pair<const std::uint64_t, size_t> &i){ return same(a[i.second], b[k]); });
+            if(found != range.second){
+                match[k] = found->second;
+                used[found->second] = true;
+                identical[k] = true;
+                by_hash.erase(found);
+            }
+        }
+        for(size_t k = pre, i = pre; k < b_end; k++){
+            if(match[k] != none){
+                continue;
+            }
+            while(i < a_end && used[i]){
+                i++;
+            }
+            if(i < a_end){
+                match[k] = i;
+                used[i] = true;
+            }
+        }
+        for(size_t i = a_end; i-- > pre;){
+            if(!used[i]){
+                result.push_back({kind::erase, path(i), 0, T()});
+            }
+        }
+        //put survivors to their places, insert new ones
+        std::vector<size_t> cur;
+        for(size_t i = pre; i < a_end; i++){
+            if(used[i]){
+                cur.emplace_back(i);
+            }
+        }
+        for(size_t k = pre; k < b_end; k++){
+            auto q = k - pre;
+            if(match[k] == none){
+                insert_subtree(b[k], path(k));
+                cur.insert(cur.begin() + q, none);
+                continue;
+            }
+            auto p = std::find(cur.begin() + q, cur.end(), match[k]) - cur.begin();
+            if(static_cast<size_t>(p) != q){
+                result.push_back({kind::move, path(pre + p), k, T()});
+                std::rotate(cur.begin() + q, cur.begin() + p, cur.begin() + p + 1);
+            }
+            if(!identical[k]){
+                jobs.push_back({a[match[k]], b[k], path(k)});
+            }
+        }
+    }
+    return result;
+}
+
+template<class T, class... Policies>
+void apply_patch(tree<T, Policies...> &t, const patch<T> &script){
+    using node_ptr = decltype(t.begin().n);
+    using iterator = typename tree<T, Policies...>::iterator;
+    using kind = typename edit<T>::kind;
+    //last resolved path with its nodes, edits of a script are close
+    //to each other, so paths are resolved by short walks from it
+    std::vector<size_t> at;
+    std::vector<node_ptr> nodes;
+    //node at first len indices of a path, nullptr for top level
+    auto resolve = [&](const std::vector<size_t> &path, size_t len){
+        size_t d = 0;
+        while(d < len && d < at.size() && path[d] == at[d]){
+            d++;
+        }
+        if(d < len && d < at.size()){
+            //sibling of a known node
+            auto n = nodes[d];
+            for(auto i = at[d]; i < path[d]; i++){
+                n = n->right;
+            }
+            for(auto i = at[d]; i > path[d]; i--){
+                n = n->left;
+            }
+            at.resize(d);
+            nodes.resize(d);
+            at.emplace_back(path[d]);
+            nodes.emplace_back(n);
+            d++;
+        }
+        for(; d < len; d++){
+            auto n = d? nodes[d - 1]->child_begin : t.begin().n;
+            for(size_t i = 0; i < path[d]; i++){
+                n = n->right;
+            }
+            at.emplace_back(path[d]);
+            nodes.emplace_back(n);
+        }
+        return len? nodes[len - 1] : nullptr;
+    };
+    //node n is at a last index of a path after an edit, deeper nodes are unknown
+    auto settle = [&](const std::vector<size_t> &path, size_t index, node_ptr n){
+        auto depth = path.size();
+        at.resize(depth);
+        nodes.resize(depth);
+        at[depth - 1] = index;
+        nodes[depth - 1] = n;
+    };
+    for(const auto &e:script){
+        auto depth = e.path.size();
+        auto pos = e.path.back();
+        switch(e.op){
+        case kind::update:
+            t.replace(iterator(resolve(e.path, depth)), e.value);
+            break;
+        case kind::erase:{
+            auto n = resolve(e.path, depth);
+            auto left = n->left;
+            t.erase(iterator(n));
+            if(pos){
+                settle(e.path, pos - 1, left);
+            }else{
+                at.resize(depth - 1);
+                nodes.resize(depth - 1);
+            }
+            break;
+        }
+        case kind::insert:{
+            auto parent = resolve(e.path, depth - 1);
+            iterator inserted = t.end();
+            if(pos){
+                auto prev = e.path;
+                prev.back() = pos - 1;
+                iterator it(resolve(prev, depth));
+                inserted = t.insert_right(it, e.value);
+            }else if(parent){
+                iterator it(parent);
+                inserted = t.prepend_child(it, e.value);
+            }else if(t.empty()){
+                inserted = t.set_root(e.value);
+            }else{
+                iterator it = t.begin();
+                inserted = t.insert_left(it, e.value);
+            }
+            settle(e.path, pos, inserted.n);
+            break;
+        }
+        case kind::move:{
+            auto n = resolve(e.path, depth);
+            //e.to counts siblings without a moved node
+            auto next = e.path;
+            next.back() = (e.to < pos)? e.to : e.to + 1;
+            auto sibling = resolve(next, depth);
+            if(sibling && sibling != t.end().n){
+                t.move_left(iterator(n), iterator(sibling));
+            }else{
+                auto last = n->parent? n->parent->child_end : t.end().n->left;
+                t.move_right(iterator(n), iterator(last));
+            }
+            settle(e.path, e.to, n);
+            break;
+        }
+        }
+    }
+}
+
 template<class It, class Ret>
 Ret algo::depth_between(const It &lhs, const It &rhs){
     typename It::difference_type i = 0;
@@ -940,4 +4448,22 @@ bool algo::is_right_to(const It &lhs, const It &rhs){
     return algo::breadth_between(lhs, rhs) != 0;
 }
 
+std::uint64_t algo::hash_mix(std::uint64_t x){
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+};
+
+namespace std{
+template<class Word, unsigned SlotBits>
+struct hash<k_tree::policy::basic_handle<Word, SlotBits>>{
+    size_t operator()(const k_tree::policy::basic_handle<Word, SlotBits> &h)const{
+        return std::hash<Word>()(h.value());
+    }
+};
 };
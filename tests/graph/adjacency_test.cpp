@@ -0,0 +1,89 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <iterator>
+#include <cassert>
+#include "graph.hpp"
+
+template<class Graph>
+void check_edges(Graph &gr){
+    using it_type = typename Graph::bfs_iterator;
+    for(size_t id = 0; id < gr.size(); id++){
+        auto it = gr.at(id);
+        for(auto adjacent:Graph::get_adjacent(it)){
+            auto edge = Graph::find_edge(it, adjacent);
+            assert(edge && it_type(edge->m_node) == adjacent);
+            auto reverse = Graph::find_edge(adjacent, it);
+            assert(reverse && it_type(reverse->m_node) == it);
+            assert(Graph::is_adjacent(it, adjacent) && Graph::is_adjacent(adjacent, it));
+        }
+    }
+}
+
+template<class Graph>
+void run(){
+    using it_type = typename Graph::bfs_iterator;
+    //two hubs with many leaves, a path between them
+    Graph gr;
+    auto hub_one = gr.insert(-1);
+    auto middle = gr.add_adjacent(hub_one, -2);
+    auto hub_two = gr.add_adjacent(middle, -3);
+    std::vector<it_type> leaves;
+    for(int i = 0; i < 20000; i++){
+        leaves.emplace_back(gr.add_adjacent((i % 2)? hub_one : hub_two, i));
+    }
+    assert(Graph::is_adjacent(hub_one, middle));
+    assert(!Graph::is_adjacent(hub_one, hub_two));
+    assert(Graph::is_adjacent(leaves[1], hub_one) && Graph::is_adjacent(hub_one, leaves[1]));
+    assert(!Graph::is_adjacent(leaves[0], hub_one) && !Graph::is_adjacent(hub_one, leaves[0]));
+    assert(!Graph::is_adjacent(leaves[0], leaves[1]));
+    assert(Graph::find_edge(hub_one, hub_two) == nullptr);
+    auto edge = Graph::find_edge(hub_two, leaves[4]);
+    assert(edge && *it_type(edge->m_node) == 4);
+
+    //view of adjacent nodes
+    auto adjacent = Graph::get_adjacent(middle);
+    assert(adjacent.size() == 2 && !adjacent.empty());
+    assert(adjacent[0] == hub_one && *adjacent.begin() == hub_one);
+    assert(*(adjacent.end() - 1) == hub_two);
+    assert(std::distance(adjacent.begin(), adjacent.end()) == 2);
+    int sum = 0;
+    for(auto it:Graph::get_adjacent(hub_one)){
+        sum += (*it > 0);
+    }
+    assert(sum == 10000);
+    assert(Graph::get_adjacent(leaves[0]).size() == 1);
+
+    //edges stay findable after erases reorder ends of hubs
+    std::mt19937 rng(3);
+    std::shuffle(leaves.begin(), leaves.end(), rng);
+    for(int i = 0; i < 15000; i++){
+        gr.erase(leaves.back());
+        leaves.pop_back();
+    }
+    check_edges(gr);
+    std::vector<it_type> batch(leaves.begin(), leaves.begin() + 2000);
+    gr.erase_many(batch.begin(), batch.end());
+    leaves.erase(leaves.begin(), leaves.begin() + 2000);
+    check_edges(gr);
+    Graph copy(gr);
+    check_edges(copy);
+    for(auto &leaf:leaves){
+        auto hub = (*leaf % 2)? hub_one : hub_two;
+        assert(Graph::is_adjacent(leaf, hub) && Graph::is_adjacent(hub, leaf));
+    }
+
+    //many queries between hubs
+    size_t found = 0;
+    for(int i = 0; i < 2000; i++){
+        found += Graph::is_adjacent(hub_one, hub_two) + Graph::is_adjacent(middle, hub_two);
+    }
+    assert(found == 2000);
+}
+
+int main(){
+    run<cxx_graph::graph<int>>();
+    run<cxx_graph::graph<int, cxx_graph::adjacency::hashed<>>>();
+    run<cxx_graph::graph<int, cxx_graph::adjacency::hashed<4>>>();
+}
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include "graph.hpp"
+
+using graph = cxx_graph::graph<int>;
+
+template<class It>
+auto collect(It it, const graph &gr){
+    std::vector<int> result;
+    for(; it != gr.end(); ++it){
+        std::cout<< *it << " ";
+        result.emplace_back(*it);
+    }
+    std::cout<<std::endl;
+    return result;
+}
+
+int main(){
+    /*     0
+         / | \
+        1  2  3
+       / \    |
+      4   5   6
+    */
+    graph gr;
+    auto it0 = gr.insert(0);
+    auto it1 = gr.add_adjacent(it0, 1);
+    auto it2 = gr.add_adjacent(it0, 2);
+    auto it3 = gr.add_adjacent(it0, 3);
+    gr.add_adjacent(it1, 4);
+    gr.add_adjacent(it1, 5);
+    auto it6 = gr.add_adjacent(it3, 6);
+    assert(gr.size() == 7);
+
+    std::vector<int> desired = {0,1,2,3,4,5,6};
+    assert(collect(gr.bfs(it0), gr) == desired);
+    assert(collect(graph::bfs_iterator(it0), gr) == desired);
+    desired = {6,3,0,1,2,4,5};
+    assert(collect(gr.bfs(it6), gr) == desired);
+    desired = {2,0,1,3,4,5,6};
+    assert(collect(it2, gr) == desired);
+
+    //copies share discovered nodes but keep their own positions
+    auto it = gr.bfs(it0);
+    ++it;
+    auto copy = it;
+    ++it; ++it; ++it;
+    assert(*it == 4 && *copy == 1);
+    assert(*copy++ == 1 && *copy == 2);
+    --it;
+    assert(*it == 3);
+    while(it != gr.end()){
+        ++it;
+    }
+    --it;
+    assert(*it == 6);
+    //assignment shares discovered nodes like a copy, positions stay apart
+    auto assigned = gr.bfs(it6);
+    assigned = copy;
+    assert(*assigned == 2);
+    ++assigned;
+    assert(*assigned == 3 && *copy == 2);
+    assigned = gr.bfs(it2);
+    assert(*assigned == 2 && *++assigned == 0);
+    assigned = assigned;
+    assert(*assigned == 0);
+    auto first = gr.bfs(it0);
+    bool thrown = false;
+    try{
+        --first;
+    }catch(const std::out_of_range&){
+        thrown = true;
+    }
+    assert(thrown);
+
+    //long path and wide star are linear
+    graph path;
+    auto last = path.insert(0);
+    auto head = last;
+    for(int i = 1; i < 200000; i++){
+        last = path.add_adjacent(last, i);
+    }
+    int expected = 0;
+    for(auto it = path.bfs(head); it != path.end(); ++it){
+        assert(*it == expected++);
+    }
+    assert(expected == 200000);
+    graph star;
+    auto center = star.insert(-1);
+    for(int i = 0; i < 200000; i++){
+        star.add_adjacent(center, i);
+    }
+    expected = -1;
+    for(auto it = star.bfs(center); it != star.end(); ++it){
+        assert(*it == expected++);
+    }
+    assert(expected == 200000);
+}
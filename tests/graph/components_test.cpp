@@ -0,0 +1,72 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cassert>
+#include "graph.hpp"
+
+using graph = cxx_graph::graph<int>;
+
+//labels by flood fill of a snapshot
+std::vector<size_t> flood_fill(const graph::frozen &snapshot){
+    const size_t none = size_t(-1);
+    std::vector<size_t> result(snapshot.size(), none);
+    size_t label = 0;
+    for(size_t id = 0; id < snapshot.size(); id++){
+        if(result[id] != none){
+            continue;
+        }
+        snapshot.bfs(id, [&](size_t reached){ result[reached] = label; });
+        label++;
+    }
+    return result;
+}
+
+int main(){
+    /* 0-1-2  3  4-5  6
+       |___|     |_|  loop
+    */
+    graph gr;
+    auto it0 = gr.insert(0);
+    auto it1 = gr.add_adjacent(it0, 1);
+    auto it2 = gr.add_adjacent(it1, 2);
+    gr.connect(it2, it0);
+    gr.insert(3);
+    auto it4 = gr.insert(4);
+    auto it5 = gr.add_adjacent(it4, 5);
+    gr.connect(it5, it4);
+    auto it6 = gr.insert(6);
+    gr.connect(it6, it6);
+    std::vector<size_t> desired = {0,0,0,1,2,2,3};
+    assert(cxx_graph::connected_components(gr) == desired);
+    assert(cxx_graph::connected_components(gr.freeze(), 2) == desired);
+    gr.connect(it6, it1);
+    desired = {0,0,0,1,2,2,0};
+    assert(gr.connected_components(1) == desired);
+    graph empty;
+    assert(empty.connected_components().empty());
+
+    //random sparse graph with many components
+    std::mt19937_64 rng(9);
+    graph big;
+    const size_t count = 200000;
+    big.reserve(count, count);
+    for(size_t i = 0; i < count; i++){
+        big.insert(int(i));
+    }
+    for(size_t i = 0; i < count * 2 / 5; i++){
+        auto one = big.at(rng() % count);
+        //nodes are connected in long chains and in local clusters
+        auto two = (i % 2)? big.at(rng() % count) : big.at(graph::id(one) / 8 * 8);
+        big.connect(one, two);
+    }
+    auto snapshot = big.freeze();
+    auto reference = flood_fill(snapshot);
+    for(size_t threads:{1, 2, 4, 7}){
+        assert(big.connected_components(threads) == reference);
+        assert(snapshot.connected_components(threads) == reference);
+    }
+    size_t components = *std::max_element(reference.begin(), reference.end()) + 1;
+    std::cout<< "components: " << components << std::endl;
+    assert(components > 1 && components < count);
+}
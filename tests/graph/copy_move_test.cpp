@@ -0,0 +1,155 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include <stdexcept>
+#include "graph.hpp"
+
+using graph = cxx_graph::graph<std::string>;
+
+int live = 0;
+struct counted{
+    counted(){ live++; }
+    counted(const counted&){ live++; }
+    ~counted(){ live--; }
+};
+
+//rebuild of the index fails after a few nodes, like an allocation of hashed
+int rebuilds_left = -1;
+struct failing: cxx_graph::adjacency::hashed<1>{
+    template<class Node>
+    static void on_rebuild(Node *n){
+        if(rebuilds_left >= 0 && !rebuilds_left--){
+            throw std::bad_alloc();
+        }
+        hashed::on_rebuild(n);
+    }
+};
+
+auto collect(const graph &gr){
+    std::vector<std::string> result;
+    if(!gr.size()){
+        return result;
+    }
+    for(auto it = gr.bfs(gr.at(0)); it != gr.end(); ++it){
+        std::cout<< *it << " ";
+        result.emplace_back(*it);
+    }
+    std::cout<<std::endl;
+    return result;
+}
+
+/*     a
+     / | \
+    b  c  d   h
+   / \    |
+  e   f   g
+*/
+graph make_graph(){
+    graph gr;
+    auto a = gr.insert("a");
+    auto b = gr.add_adjacent(a, "b");
+    gr.add_adjacent(a, "c");
+    auto d = gr.add_adjacent(a, "d");
+    gr.add_adjacent(b, "e");
+    gr.add_adjacent(b, "f");
+    gr.add_adjacent(d, "g");
+    gr.insert("h");
+    return gr;
+}
+
+int main(){
+    auto gr = make_graph();
+    auto snapshot = gr.freeze();
+    const std::vector<std::string> desired = {"a","b","c","d","e","f","g"};
+    assert(collect(gr) == desired);
+
+    //copy has the same structure and ids but its own nodes
+    graph copy(gr);
+    assert(copy.size() == gr.size());
+    auto copied = copy.freeze();
+    assert(copied.offsets() == snapshot.offsets());
+    assert(copied.targets() == snapshot.targets());
+    assert(copied.values() == snapshot.values());
+    assert(collect(copy) == desired);
+    assert(graph::id(copy.at(3)) == 3 && *copy.at(3) == "d");
+    assert(copy.at(1) != gr.at(1));
+
+    //copy grows and shrinks independently
+    auto c = copy.at(2);
+    copy.add_adjacent(c, "i");
+    auto b = copy.at(1);
+    copy.erase(b);
+    assert(collect(copy) == std::vector<std::string>({"a","d","c","g","i"}));
+    assert(collect(gr) == desired);
+    assert(gr.freeze().targets() == snapshot.targets());
+
+    //move takes nodes, source is empty and usable
+    graph moved(std::move(copy));
+    assert(moved.size() == 8);
+    assert(copy.size() == 0);
+    auto x = copy.insert("x");
+    copy.add_adjacent(x, "y");
+    assert(collect(copy) == std::vector<std::string>({"x","y"}));
+    assert(*moved.at(0) == "a");
+
+    //assignments
+    copy = gr;
+    assert(copy.freeze().values() == snapshot.values());
+    auto &same = copy;
+    copy = same;
+    assert(collect(copy) == desired);
+    graph other;
+    other = std::move(moved);
+    assert(moved.size() == 0);
+    assert(other.size() == 8);
+    other = graph();
+    assert(other.size() == 0);
+    other = std::move(copy);
+    assert(collect(other) == desired);
+
+    //copy of a graph with erased nodes and grown arrays
+    graph big;
+    auto center = big.insert("center");
+    for(int i = 0; i < 1000; i++){
+        big.add_adjacent(center, std::to_string(i));
+    }
+    for(size_t i = 1; i < big.size(); i += 2){
+        auto it = big.at(i);
+        big.erase(it);
+    }
+    graph big_copy = big;
+    auto big_frozen = big.freeze(), copy_frozen = big_copy.freeze();
+    assert(big_frozen.targets() == copy_frozen.targets());
+    assert(big_frozen.values() == copy_frozen.values());
+    assert(copy_frozen.degree(0) == big_copy.size() - 1);
+    //exact arrays of a copy grow as usual
+    auto copy_center = big_copy.at(0);
+    for(int i = 0; i < 100; i++){
+        big_copy.add_adjacent(copy_center, "new");
+    }
+    assert(big_copy.freeze().degree(0) == big.size() + 99);
+
+    //failed copy destroys every node it has created
+    {
+        cxx_graph::graph<counted, failing> path;
+        auto last = path.insert(counted());
+        for(int i = 0; i < 10; i++){
+            last = path.add_adjacent(last, counted());
+        }
+        assert(live == 11);
+        rebuilds_left = 5;
+        bool thrown = false;
+        try{
+            auto path_copy = path;
+        }catch(const std::bad_alloc&){
+            thrown = true;
+        }
+        assert(thrown);
+        assert(live == 11);
+        rebuilds_left = -1;
+        auto path_copy = path;
+        assert(live == 22);
+    }
+    assert(live == 0);
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include "graph.hpp"
+
+using graph = cxx_graph::graph<int>;
+
+template<class It>
+auto collect(It it, const graph &gr){
+    std::vector<int> result;
+    for(; it != gr.end(); ++it){
+        std::cout<< *it << " ";
+        result.emplace_back(*it);
+    }
+    std::cout<<std::endl;
+    return result;
+}
+
+int main(){
+    /*     0
+         / | \
+        1  2  3
+       / \    |
+      4   5   6
+    */
+    graph gr;
+    auto it0 = gr.insert(0);
+    auto it1 = gr.add_adjacent(it0, 1);
+    gr.add_adjacent(it0, 2);
+    auto it3 = gr.add_adjacent(it0, 3);
+    gr.add_adjacent(it1, 4);
+    gr.add_adjacent(it1, 5);
+    auto it6 = gr.add_adjacent(it3, 6);
+
+    std::vector<int> desired = {0,1,4,5,2,3,6};
+    assert(collect(gr.dfs(it0), gr) == desired);
+    assert(collect(graph::dfs_iterator(it0), gr) == desired);
+    desired = {4,5,1,2,6,3,0};
+    assert(collect(gr.dfs(it0, graph::dfs_order::postorder), gr) == desired);
+    desired = {6,3,0,1,4,5,2};
+    assert(collect(gr.dfs(it6), gr) == desired);
+    desired = {2,6,3,0,4,5,1};
+    assert(collect(graph::dfs_iterator(it1, graph::dfs_order::postorder), gr) == desired);
+
+    //copies share given nodes but keep their own positions
+    auto it = gr.dfs(it0, graph::dfs_order::postorder);
+    auto copy = it++;
+    assert(*copy == 4 && *it == 5);
+    ++it; ++it;
+    assert(*it == 2);
+    --it;
+    assert(*it == 1 && *++copy == 5);
+    while(it != gr.end()){
+        it++;
+    }
+    assert(*--it == 0);
+
+    //million node path does not overflow a stack
+    graph path;
+    auto last = path.insert(0);
+    auto head = last;
+    const int count = 1000000;
+    for(int i = 1; i < count; i++){
+        last = path.add_adjacent(last, i);
+    }
+    int expected = 0;
+    for(auto it = path.dfs(head); it != path.end(); ++it){
+        assert(*it == expected++);
+    }
+    assert(expected == count);
+    for(auto it = path.dfs(head, graph::dfs_order::postorder); it != path.end(); ++it){
+        assert(*it == --expected);
+    }
+    assert(expected == 0);
+}
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <vector>
+#include <set>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <cassert>
+#include "graph.hpp"
+
+using graph = cxx_graph::graph<int>;
+using adjacency = std::map<int, std::multiset<int>>;
+
+//adjacency by values, values are unique
+adjacency adjacency_of(const graph &gr){
+    auto snapshot = gr.freeze();
+    adjacency result;
+    for(size_t id = 0; id < snapshot.size(); id++){
+        auto &adjacent = result[snapshot.value(id)];
+        for(auto other:snapshot.neighbours(id)){
+            adjacent.insert(snapshot.value(other));
+        }
+    }
+    return result;
+}
+
+void erase_from(adjacency &model, int val){
+    for(auto other:model[val]){
+        if(other != val){
+            model[other].erase(model[other].find(val));
+        }
+    }
+    model.erase(val);
+}
+
+int main(){
+    //random tree, model of its adjacency
+    std::mt19937 rng(7);
+    graph gr;
+    adjacency model;
+    std::vector<graph::bfs_iterator> nodes = {gr.insert(0)};
+    model[0];
+    for(int i = 1; i < 20000; i++){
+        auto parent = rng() % nodes.size();
+        //hubs get most of the edges
+        if(rng() % 2){
+            parent %= 10;
+        }
+        nodes.emplace_back(gr.add_adjacent(nodes[parent], i));
+        model[*nodes[parent]].insert(i);
+        model[i].insert(*nodes[parent]);
+    }
+    assert(adjacency_of(gr) == model);
+
+    //single erases keep ends and ids consistent
+    std::shuffle(nodes.begin(), nodes.end(), rng);
+    for(int i = 0; i < 5000; i++){
+        auto val = *nodes.back();
+        gr.erase(nodes.back());
+        nodes.pop_back();
+        erase_from(model, val);
+    }
+    assert(adjacency_of(gr) == model);
+    for(size_t id = 0; id < gr.size(); id++){
+        assert(graph::id(gr.at(id)) == id);
+    }
+
+    //batch with repeats, hubs and their neighbours
+    std::vector<graph::bfs_iterator> batch(nodes.end() - 5000, nodes.end());
+    batch.emplace_back(batch.front());
+    for(auto &it:batch){
+        if(model.count(*it)){
+            erase_from(model, *it);
+        }
+    }
+    nodes.erase(nodes.end() - 5000, nodes.end());
+    assert(gr.erase_many(batch.begin(), batch.end()) == 5000);
+    assert(gr.size() == 10000);
+    assert(adjacency_of(gr) == model);
+    auto count = 0;
+    for(auto it = gr.bfs(nodes.front()); it != gr.end(); ++it){
+        count++;
+    }
+    assert(count > 0);
+
+    //erase of a hub and its leaves is linear
+    graph star;
+    auto center = star.insert(-1);
+    std::vector<graph::bfs_iterator> leaves;
+    for(int i = 0; i < 200000; i++){
+        leaves.emplace_back(star.add_adjacent(center, i));
+    }
+    for(size_t i = 0; i < leaves.size(); i += 2){
+        star.erase(leaves[i]);
+    }
+    assert(star.size() == 100001);
+    assert(star.freeze().degree(graph::id(center)) == 100000);
+    star.erase(center);
+    assert(star.freeze().edge_count() == 0);
+    star.clear();
+    assert(star.size() == 0);
+    auto it = star.insert(1);
+    star.add_adjacent(it, 2);
+    assert(star.size() == 2);
+
+    gr.clear();
+    assert(gr.size() == 0);
+    std::vector<graph::bfs_iterator> none;
+    assert(gr.erase_many(none.begin(), none.end()) == 0);
+}
@@ -0,0 +1,93 @@
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include "graph.hpp"
+
+using graph = cxx_graph::graph<int>;
+
+template<class It>
+auto collect(It it, const graph &gr){
+    std::vector<int> result;
+    for(; it != gr.end(); ++it){
+        result.emplace_back(*it);
+    }
+    return result;
+}
+
+auto collect(const graph::frozen &snapshot, size_t source, bool breadth,
+    graph::dfs_order order = graph::dfs_order::preorder)
+{
+    std::vector<int> result;
+    auto visit = [&](size_t id){
+        std::cout<< snapshot.value(id) << " ";
+        result.emplace_back(snapshot.value(id));
+    };
+    if(breadth){
+        snapshot.bfs(source, visit);
+    }else{
+        snapshot.dfs(source, visit, order);
+    }
+    std::cout<<std::endl;
+    return result;
+}
+
+int main(){
+    /*     0
+         / | \
+        1  2  3
+       / \    |
+      4   5   6
+    */
+    graph gr;
+    auto it0 = gr.insert(0);
+    auto it1 = gr.add_adjacent(it0, 1);
+    gr.add_adjacent(it0, 2);
+    auto it3 = gr.add_adjacent(it0, 3);
+    gr.add_adjacent(it1, 4);
+    gr.add_adjacent(it1, 5);
+    auto it6 = gr.add_adjacent(it3, 6);
+    gr.insert(7);
+
+    auto snapshot = gr.freeze();
+    assert(snapshot.size() == 8);
+    assert(snapshot.edge_count() == 12);
+    assert(snapshot.offsets().size() == 9);
+    assert(snapshot.degree(graph::id(it0)) == 3);
+    assert(snapshot.degree(graph::id(it6)) == 1);
+    assert(snapshot.degree(7) == 0);
+    std::vector<size_t> desired_ids = {0,4,5};
+    auto neighbours = snapshot.neighbours(graph::id(it1));
+    assert(std::vector<size_t>(neighbours.begin(), neighbours.end()) == desired_ids);
+
+    //traversals match iterators of a graph
+    assert(collect(snapshot, 0, true) == collect(gr.bfs(it0), gr));
+    assert(collect(snapshot, graph::id(it6), true) == collect(gr.bfs(it6), gr));
+    assert(collect(snapshot, 0, false) == collect(gr.dfs(it0), gr));
+    assert(collect(snapshot, graph::id(it1), false, graph::dfs_order::postorder)
+        == collect(gr.dfs(it1, graph::dfs_order::postorder), gr));
+    std::vector<int> desired = {7};
+    assert(collect(snapshot, 7, true) == desired);
+
+    //snapshot owns its values
+    snapshot.value(0) = 10;
+    assert(*it0 == 0);
+    assert(snapshot.values()[0] == 10);
+
+    //wide and deep snapshot
+    graph big;
+    auto last = big.insert(0);
+    for(int i = 1; i < 300000; i++){
+        last = big.add_adjacent(last, i);
+        if(i % 3 == 0){
+            big.add_adjacent(last, -i);
+        }
+    }
+    auto frozen_big = big.freeze();
+    assert(frozen_big.size() == big.size());
+    size_t reached = 0;
+    frozen_big.dfs(0, [&](size_t){ reached++; }, graph::dfs_order::postorder);
+    assert(reached == big.size());
+    reached = 0;
+    frozen_big.bfs(0, [&](size_t){ reached++; });
+    assert(reached == big.size());
+}
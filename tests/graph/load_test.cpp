@@ -0,0 +1,194 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <random>
+#include <cstdint>
+#include <cstdio>
+#include <cassert>
+#include "graph.hpp"
+
+using graph = cxx_graph::graph<int>;
+using cxx_graph::edge_list_format;
+using adjacency = std::vector<std::multiset<size_t>>;
+
+adjacency adjacency_of(const graph &gr){
+    auto snapshot = gr.freeze();
+    adjacency result(snapshot.size());
+    for(size_t id = 0; id < snapshot.size(); id++){
+        for(auto other:snapshot.neighbours(id)){
+            result[id].insert(other);
+        }
+    }
+    return result;
+}
+
+adjacency adjacency_of(const std::vector<std::pair<std::uint64_t, std::uint64_t>> &edges, size_t count){
+    adjacency result(count);
+    for(auto &edge:edges){
+        result[edge.first].insert(edge.second);
+        result[edge.second].insert(edge.first);
+    }
+    return result;
+}
+
+//every end has a reverse end at its back index
+void check_ends(graph &gr){
+    for(size_t id = 0; id < gr.size(); id++){
+        auto it = gr.at(id);
+        auto adjacent = graph::get_adjacent(it);
+        for(auto other:adjacent){
+            assert(graph::is_adjacent(other, it));
+        }
+        if(adjacent.empty()){
+            continue;
+        }
+        //an end in edges of a neighbour leads to a node itself
+        auto n = graph::find_edge(adjacent[0], it)->m_node;
+        assert(n->m_id == id && n->m_edges.size() == adjacent.size());
+        for(size_t i = 0; i < n->m_edges.size(); i++){
+            auto &e = n->m_edges[i];
+            assert(e.m_back < e.m_node->m_edges.size());
+            auto &back = e.m_node->m_edges[e.m_back];
+            assert(back.m_node == n);
+            assert(back.m_back == i);
+        }
+    }
+    auto copy = gr;
+    assert(adjacency_of(copy) == adjacency_of(gr));
+}
+
+int main(){
+    //connecting existing nodes makes cycles, loops and parallel edges
+    graph gr;
+    auto it0 = gr.insert(0);
+    auto it1 = gr.add_adjacent(it0, 1);
+    auto it2 = gr.add_adjacent(it1, 2);
+    auto it3 = gr.insert(3);
+    assert(!graph::is_adjacent(it0, it2));
+    auto edge = gr.connect(it2, it0);
+    assert(edge && graph::bfs_iterator(edge->m_node) == it0);
+    assert(graph::is_adjacent(it0, it2) && graph::is_adjacent(it2, it0));
+    auto loop = gr.connect(it3, it3);
+    assert(graph::bfs_iterator(loop->m_node) == it3);
+    gr.connect(it3, it0);
+    gr.connect(it0, it3);
+    assert(graph::get_adjacent(it3).size() == 4);
+    auto distance = gr.parallel_bfs(it1, 1).m_distance;
+    std::vector<size_t> desired = {1,0,1,2};
+    assert(distance == desired);
+    std::vector<int> visited;
+    for(auto it = gr.dfs(it0); it != gr.end(); ++it){
+        visited.emplace_back(*it);
+    }
+    assert(visited.size() == 4);
+    check_ends(gr);
+    gr.erase(it3);
+    assert(graph::get_adjacent(it0).size() == 2);
+    check_ends(gr);
+    auto it4 = gr.add_adjacent(it2, 4);
+    gr.connect(it4, it4);
+    std::vector<graph::bfs_iterator> batch = {it4, it1};
+    gr.erase_many(batch.begin(), batch.end());
+    assert(gr.size() == 2);
+    assert(graph::is_adjacent(it0, it2) && graph::get_adjacent(it0).size() == 1);
+
+    //random multigraph with loops written as files
+    std::mt19937_64 rng(5);
+    const size_t count = 10000;
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> edges;
+    for(int i = 0; i < 60000; i++){
+        auto one = rng() % count;
+        edges.emplace_back(one, (i % 100)? rng() % count : one);
+    }
+    edges.emplace_back(count - 1, 0);
+    auto desired_adjacency = adjacency_of(edges, count);
+    const std::string text = "graph_load_test.txt", bin32 = "graph_load_test.bin32",
+        bin64 = "graph_load_test.bin64";
+    {
+        std::ofstream out(text);
+        out << "# comment line\n% another one\n\n";
+        for(size_t i = 0; i < edges.size(); i++){
+            out << edges[i].first << ((i % 2)? "\t" : " ") << edges[i].second;
+            out << ((i % 3)? "\n" : " 1.5\r\n");
+        }
+        std::ofstream out32(bin32, std::ios::binary), out64(bin64, std::ios::binary);
+        for(auto &edge:edges){
+            std::uint32_t ids32[] = {std::uint32_t(edge.first), std::uint32_t(edge.second)};
+            std::uint64_t ids64[] = {edge.first, edge.second};
+            out32.write(reinterpret_cast<const char*>(ids32), sizeof(ids32));
+            out64.write(reinterpret_cast<const char*>(ids64), sizeof(ids64));
+        }
+    }
+    for(size_t threads:{1, 3}){
+        for(auto format:{edge_list_format::text, edge_list_format::binary32, edge_list_format::binary64}){
+            auto path = (format == edge_list_format::text)? text :
+                (format == edge_list_format::binary32)? bin32 : bin64;
+            auto loaded = graph::load_edge_list(path, format, threads);
+            assert(loaded.size() == count);
+            assert(adjacency_of(loaded) == desired_adjacency);
+            assert(*loaded.at(7) == 0);
+            check_ends(loaded);
+            //loaded graph grows and shrinks as usual
+            auto first = loaded.at(0);
+            auto extra = loaded.add_adjacent(first, -1);
+            loaded.connect(extra, loaded.at(1));
+            auto last = loaded.at(count - 1);
+            loaded.erase(last);
+            check_ends(loaded);
+        }
+    }
+    //small file of loops and parallel edges, both ends of a loop are in one array
+    {
+        std::ofstream out(text);
+        out << "0 0\n0 1\n1 0\n0 1\n1 1\n1 1\n2 2\n0 2\n";
+    }
+    for(size_t threads:{1, 3}){
+        auto loaded = graph::load_edge_list(text, edge_list_format::text, threads);
+        assert(loaded.size() == 3);
+        assert(graph::get_adjacent(loaded.at(0)).size() == 6);
+        assert(graph::get_adjacent(loaded.at(1)).size() == 7);
+        assert(graph::get_adjacent(loaded.at(2)).size() == 3);
+        assert(adjacency_of(loaded) == adjacency_of({{0,0},{0,1},{1,0},{0,1},{1,1},{1,1},{2,2},{0,2}}, 3));
+        check_ends(loaded);
+        auto one = loaded.at(1);
+        loaded.erase(one);
+        assert(graph::get_adjacent(loaded.at(0)).size() == 3);
+        check_ends(loaded);
+    }
+
+    using hashed = cxx_graph::graph<int, cxx_graph::adjacency::hashed<8>>;
+    auto indexed = hashed::load_edge_list(bin32, edge_list_format::binary32);
+    for(auto &edge:edges){
+        assert(hashed::is_adjacent(indexed.at(edge.first), indexed.at(edge.second)));
+    }
+
+    //errors
+    bool thrown = false;
+    try{
+        graph::load_edge_list("no_such_file.txt");
+    }catch(const std::runtime_error&){
+        thrown = true;
+    }
+    assert(thrown);
+    {
+        std::ofstream out(text);
+        out << "1 2\n3\n";
+    }
+    thrown = false;
+    try{
+        graph::load_edge_list(text);
+    }catch(const std::runtime_error&){
+        thrown = true;
+    }
+    assert(thrown);
+    {
+        std::ofstream out(text);
+    }
+    assert(graph::load_edge_list(text).size() == 0);
+    std::remove(text.c_str());
+    std::remove(bin32.c_str());
+    std::remove(bin64.c_str());
+}
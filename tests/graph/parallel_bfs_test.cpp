@@ -0,0 +1,100 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cassert>
+#include "graph.hpp"
+
+using graph = cxx_graph::graph<int>;
+using cxx_graph::bfs_result;
+
+//distances by a plain sequential search of a snapshot
+std::vector<size_t> distances(const graph::frozen &snapshot, size_t source){
+    std::vector<size_t> result(snapshot.size(), bfs_result::npos);
+    result[source] = 0;
+    snapshot.bfs(source, [&](size_t id){
+        for(auto other:snapshot.neighbours(id)){
+            if(result[other] == bfs_result::npos){
+                result[other] = result[id] + 1;
+            }
+        }
+    });
+    return result;
+}
+
+void check(const graph::frozen &snapshot, const bfs_result &result, size_t source){
+    assert(result.m_distance == distances(snapshot, source));
+    for(size_t id = 0; id < snapshot.size(); id++){
+        auto parent = result.m_parent[id];
+        if(result.m_distance[id] == bfs_result::npos){
+            assert(parent == bfs_result::npos);
+        }else if(id == source){
+            assert(parent == source);
+        }else{
+            auto neighbours = snapshot.neighbours(id);
+            assert(std::find(neighbours.begin(), neighbours.end(), parent) != neighbours.end());
+            assert(result.m_distance[parent] + 1 == result.m_distance[id]);
+        }
+    }
+}
+
+int main(){
+    /*     0
+         / | \
+        1  2  3   7
+       / \    |
+      4   5   6
+    */
+    graph small;
+    auto it0 = small.insert(0);
+    auto it1 = small.add_adjacent(it0, 1);
+    small.add_adjacent(it0, 2);
+    auto it3 = small.add_adjacent(it0, 3);
+    small.add_adjacent(it1, 4);
+    small.add_adjacent(it1, 5);
+    auto it6 = small.add_adjacent(it3, 6);
+    small.insert(7);
+    auto result = cxx_graph::parallel_bfs(small, it6);
+    std::vector<size_t> desired = {2,3,3,1,4,4,0,bfs_result::npos};
+    assert(result.m_distance == desired);
+    assert(result.m_parent[graph::id(it1)] == graph::id(it0));
+    assert(result.m_parent[graph::id(it6)] == graph::id(it6));
+    assert(result.m_distance == cxx_graph::parallel_bfs(small.freeze(), graph::id(it6)).m_distance);
+
+    //random tree with hubs, wide levels go bottom-up
+    std::mt19937 rng(11);
+    graph gr;
+    std::vector<graph::bfs_iterator> nodes = {gr.insert(0)};
+    for(int i = 1; i < 100000; i++){
+        auto parent = rng() % nodes.size();
+        if(rng() % 4 == 0){
+            parent %= 16;
+        }
+        nodes.emplace_back(gr.add_adjacent(nodes[parent], i));
+    }
+    //and a long path, with many narrow levels
+    auto last = nodes.back();
+    for(int i = 0; i < 5000; i++){
+        last = gr.add_adjacent(last, -i);
+    }
+    gr.insert(-1);
+    auto snapshot = gr.freeze();
+    for(size_t threads:{1, 2, 4}){
+        auto from_root = gr.parallel_bfs(nodes.front(), threads);
+        check(snapshot, from_root, 0);
+        auto from_leaf = snapshot.parallel_bfs(graph::id(last), threads);
+        check(snapshot, from_leaf, graph::id(last));
+        //tree has one parent per node, so results do not depend on threads
+        assert(from_root.m_parent == gr.parallel_bfs(nodes.front(), 1).m_parent);
+    }
+
+    //star is bottom-up from its second level
+    graph star;
+    auto center = star.insert(0);
+    for(int i = 1; i < 100000; i++){
+        star.add_adjacent(center, i);
+    }
+    auto star_frozen = star.freeze();
+    check(star_frozen, cxx_graph::parallel_bfs(star, star.at(500), 4), 500);
+    check(star_frozen, cxx_graph::parallel_bfs(star_frozen, 0), 0);
+}
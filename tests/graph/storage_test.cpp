@@ -0,0 +1,119 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <new>
+#include <cstdlib>
+#include <cassert>
+#include "graph.hpp"
+
+static size_t heap_counter = 0;
+
+void* operator new(std::size_t size){
+    heap_counter++;
+    if(auto p = std::malloc(size? size : 1)){
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p)noexcept{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t)noexcept{
+    std::free(p);
+}
+
+using graph = cxx_graph::graph<int>;
+
+template<class It>
+auto collect(It it, const graph &gr){
+    std::vector<int> result;
+    for(; it != gr.end(); ++it){
+        std::cout<< *it << " ";
+        result.emplace_back(*it);
+    }
+    std::cout<<std::endl;
+    return result;
+}
+
+int main(){
+    //million edges take a handful of allocations
+    {
+        const int count = 1000000;
+        graph gr;
+        auto before = heap_counter;
+        auto last = gr.insert(0);
+        for(int i = 1; i < count; i++){
+            last = (i % 4)? gr.add_adjacent(last, i) : gr.add_adjacent(last, -i);
+        }
+        auto grown = heap_counter - before;
+        std::cout<< "allocations while growing: " << grown << std::endl;
+        assert(grown < 200);
+        assert(gr.size() == size_t(count));
+
+        graph reserved;
+        before = heap_counter;
+        reserved.reserve(count, count - 1);
+        auto center = reserved.insert(0);
+        for(int i = 1; i < count; i++){
+            reserved.add_adjacent(center, i);
+        }
+        auto preallocated = heap_counter - before;
+        std::cout<< "allocations with reserve: " << preallocated << std::endl;
+        assert(preallocated < 50);
+    }
+
+    /*     0
+         / | \
+        1  2  3
+       / \    |
+      4   5   6
+    */
+    graph gr;
+    auto it0 = gr.insert(0);
+    auto it1 = gr.add_adjacent(it0, 1);
+    auto it2 = gr.add_adjacent(it0, 2);
+    auto it3 = gr.add_adjacent(it0, 3);
+    gr.add_adjacent(it1, 4);
+    auto it5 = gr.add_adjacent(it1, 5);
+    auto it6 = gr.add_adjacent(it3, 6);
+    assert(graph::is_adjacent(it0, it3) && graph::is_adjacent(it3, it0));
+    assert(!graph::is_adjacent(it0, it6));
+    assert(graph::get_adjacent(it1).size() == 3);
+
+    //erase unlinks a node from its neighbours, ids stay dense
+    gr.erase(it1);
+    assert(gr.size() == 6);
+    std::vector<int> desired = {0,3,2,6};
+    assert(collect(gr.bfs(it0), gr) == desired);
+    assert(graph::id(it6) == 1);
+    desired = {5};
+    assert(collect(gr.bfs(it5), gr) == desired);
+    assert(graph::get_adjacent(it5).empty());
+    gr.erase(it3);
+    desired = {0,2};
+    assert(collect(gr.dfs(it0), gr) == desired);
+    assert(graph::get_adjacent(it6).empty());
+
+    //freed nodes and edge arrays are reused
+    auto before = heap_counter;
+    for(int i = 0; i < 100; i++){
+        auto it = gr.add_adjacent(it2, 10 + i);
+        gr.add_adjacent(it, 20 + i);
+        gr.erase(it);
+    }
+    assert(heap_counter - before < 10);
+    assert(graph::get_adjacent(it2).size() == 1);
+    auto snapshot = gr.freeze();
+    assert(snapshot.size() == gr.size());
+    assert(snapshot.edge_count() == 2);
+
+    //values are destroyed with a graph
+    cxx_graph::graph<std::string> strings;
+    auto a = strings.insert(std::string(100, 'a'));
+    auto b = strings.add_adjacent(a, std::string(100, 'b'));
+    strings.add_adjacent(b, "c");
+    strings.erase(b);
+    assert(*strings.bfs(a) == std::string(100, 'a'));
+}
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <vector>
+#include <cassert>
 #include "k_tree.hpp"
 
 using tree_ = k_tree::tree<int>;
@@ -33,4 +34,32 @@ int main(){
     std::cout<<std::endl; 
     std::vector<int> desired = {0,1,2,5,7,6,3,4};
     assert(result == desired);
+
+    /* 0-8-9
+       |   |
+       1   10
+       top level siblings go first, then their children level by level
+    */
+    tree_ forest;
+    auto f0 = forest.set_root(0);
+    forest.append_child(f0, 1);
+    auto f8 = forest.insert_right(f0, 8);
+    auto f9 = forest.insert_right(f8, 9);
+    forest.append_child(f9, 10);
+    result.clear();
+    for(tree_::breadth_first_iterator fit = forest.begin(); fit != forest.end(); fit++){
+        std::cout<< *fit << " ";
+        result.emplace_back(*fit);
+    }
+    std::cout<<std::endl;
+    desired = {0,8,9,1,10};
+    assert(result == desired);
+
+    //single top level node without children, and an empty tree
+    tree_ single;
+    single.set_root(1);
+    tree_::breadth_first_iterator sit = single.begin();
+    assert(*sit == 1 && ++sit == single.end());
+    tree_ empty;
+    assert(tree_::breadth_first_iterator(empty.begin()) == empty.end());
 }
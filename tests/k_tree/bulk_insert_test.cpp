@@ -0,0 +1,79 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <cassert>
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<int>;
+
+auto collect(const tree_ &tree){
+    std::vector<int> result;
+    for(auto it = tree.begin(); it != tree.end(); it++){
+        std::cout<< *it << " ";
+        result.emplace_back(*it);
+    }
+    std::cout<<std::endl;
+    return result;
+}
+
+int main(){
+    /*    0
+          |
+      7-8-1-2-3-4-9
+          |
+          5-6
+     depth-wise: 0 7 8 1 5 6 2 3 4 9
+    */
+    tree_ tree;
+    auto it0 = tree.set_root(0);
+    std::vector<int> children = {1,2,3};
+    auto it1 = tree.append_children(it0, children.begin(), children.end());
+    assert(*it1 == 1);
+    children = {4};
+    tree.append_children(it0, children.begin(), children.end());
+    children = {5,6};
+    tree.prepend_children(it1, children.begin(), children.end());
+    children = {7,8};
+    tree.insert_range_left(it1, children.begin(), children.end());
+    auto it4 = std::next(tree.begin(), 8);
+    assert(*it4 == 4);
+    std::istringstream input("9");
+    tree.insert_range_right(it4,
+        std::istream_iterator<int>(input), std::istream_iterator<int>());
+    std::vector<int> desired = {0,7,8,1,5,6,2,3,4,9};
+    assert(collect(tree) == desired);
+
+    children.clear();
+    assert(tree.append_children(it0, children.begin(), children.end()) == tree.end());
+    assert(tree.size() == desired.size());
+
+    //top-level ranges update root and foot
+    tree.insert_range_left(it0, children.begin(), children.end());
+    children = {-2,-1};
+    auto new_root = tree.insert_range_left(it0, children.begin(), children.end());
+    assert(new_root == tree.begin());
+    children = {10,11};
+    tree.insert_range_right(it0, children.begin(), children.end());
+    desired = {-2,-1,0,7,8,1,5,6,2,3,4,9,10,11};
+    assert(collect(tree) == desired);
+
+    //values are moved out of rvalue ranges
+    k_tree::tree<std::unique_ptr<int>> ptr_tree;
+    auto ptr_root = ptr_tree.set_root(std::make_unique<int>(0));
+    std::vector<std::unique_ptr<int>> ptrs;
+    for(int i = 1; i <= 1000; i++){
+        ptrs.emplace_back(std::make_unique<int>(i));
+    }
+    ptr_tree.append_children(ptr_root,
+        std::make_move_iterator(ptrs.begin()), std::make_move_iterator(ptrs.end()));
+    for(auto &ptr:ptrs){
+        assert(!ptr);
+    }
+    int expected = 0;
+    for(auto it = ptr_tree.begin(); it != ptr_tree.end(); it++){
+        assert(**it == expected++);
+    }
+    assert(expected == 1001);
+    return 0;
+}
@@ -103,4 +103,43 @@ int main(){
         move = std::move(copy);
     }
     assert(bak == alloc_counter);
+
+    //erase of a root keeps its right sibling as a new root
+    bak = alloc_counter;
+    {
+        auto tree = make_tree();
+        auto it0 = tree.begin();
+        auto it6 = tree.insert_right(it0, 6);
+        tree.append_child(it6, 7);
+        tree.insert_right(it6, 8);
+        assert(tree.size() == 9);
+        tree.erase(tree.begin());
+        assert(tree.size() == 3);
+        assert((*tree.begin()).val == 6);
+        assert((*std::next(tree.begin())).val == 7);
+        auto last = tree.end();
+        last--;
+        assert((*last).val == 8);
+        tree.erase(last);
+        tree.erase(tree.begin());
+        assert(tree.empty() && tree.begin() == tree.end());
+        tree.set_root(1);
+        assert(tree.size() == 1);
+    }
+    assert(bak == alloc_counter);
+
+    //clear removes all top level nodes
+    bak = alloc_counter;
+    {
+        auto tree = make_tree();
+        auto it0 = tree.begin();
+        auto it6 = tree.insert_right(it0, 6);
+        tree.append_child(it6, 7);
+        tree.clear();
+        assert(tree.empty() && tree.size() == 0);
+        auto root = tree.set_root(1);
+        tree.append_child(root, 2);
+        assert(tree.size() == 2);
+    }
+    assert(bak == alloc_counter);
 }
\ No newline at end of file
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <cassert>
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<std::string>;
+
+//checks that values are laid out in depth-first order with a fixed stride
+bool is_contiguous(const tree_ &tree){
+    auto it = tree.begin();
+    if(it == tree.end()){
+        return true;
+    }
+    auto prev = reinterpret_cast<const char*>(&*it);
+    std::ptrdiff_t stride = 0;
+    for(it++; it != tree.end(); it++){
+        auto cur = reinterpret_cast<const char*>(&*it);
+        if(!stride){
+            stride = cur - prev;
+        }
+        if(stride <= 0 || cur - prev != stride){
+            return false;
+        }
+        prev = cur;
+    }
+    return true;
+}
+
+int main(){
+    tree_ tree;
+    tree.compact();
+    assert(tree.empty());
+
+    tree.set_root("root");
+    tree.compact();
+    assert(tree.size() == 1);
+    assert(*tree.begin() == "root");
+
+    //churn: random inserts and erases spread nodes over the pool
+    std::mt19937 gen(42);
+    std::vector<tree_::iterator> its = {tree.begin()};
+    for(int i = 0; i < 20000; i++){
+        auto &it = its[gen() % its.size()];
+        switch(gen() % 3){
+        case 0:
+            its.emplace_back(tree.append_child(it, std::to_string(i)));
+            break;
+        case 1:
+            its.emplace_back(tree.prepend_child(it, std::to_string(i)));
+            break;
+        default:
+            its.emplace_back(tree.insert_right(it, std::to_string(i)));
+            break;
+        }
+        if(i % 1000 == 999){
+            tree.prune_if([&](const std::string &val){ return gen() % 50 == 0 && val != "root"; });
+            its = {tree.begin()};
+        }
+    }
+    auto top = tree.begin();
+    tree.insert_right(top, "second");
+    tree.reserve(1000);
+    assert(!is_contiguous(tree));
+
+    tree_ copy = tree;
+    auto size = tree.size();
+    tree.compact();
+    std::cout<< "compacted " << size << " nodes" << std::endl;
+    assert(tree.size() == size);
+    assert(tree == copy);
+    assert(is_contiguous(tree));
+
+    //tree stays usable after compaction
+    auto it = tree.begin();
+    tree.append_child(it, "child");
+    tree.erase(std::next(tree.begin(), 5));
+    copy = tree;
+    tree.compact();
+    assert(tree == copy);
+    assert(is_contiguous(tree));
+    tree.clear();
+    assert(tree.empty());
+}
@@ -0,0 +1,109 @@
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<size_t>;
+const size_t per_thread = 20000;
+
+//checks that children are linked both ways and each thread kept its order
+bool check_children(tree_::iterator parent, size_t threads, size_t count){
+    std::vector<size_t> last(threads, 0);
+    size_t seen = 0;
+    decltype(parent.n) prev = nullptr;
+    for(auto n = parent.n->child_begin; n; n = n->right){
+        if(n->left != prev || n->parent != parent.n){
+            return false;
+        }
+        auto thread = n->value() / per_thread, index = n->value() % per_thread + 1;
+        if(index <= last[thread]){
+            return false;
+        }
+        last[thread] = index;
+        prev = n;
+        seen++;
+    }
+    return seen == count && parent.n->child_end == prev;
+}
+
+//threads append under own parents or under one shared parent
+void run(size_t threads, bool shared){
+    tree_ tree;
+    auto root = tree.set_root(0);
+    std::vector<tree_::iterator> parents;
+    for(size_t i = 0; i < threads; i++){
+        parents.emplace_back(shared? root : tree.append_child(root, i));
+    }
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < threads; i++){
+        workers.emplace_back([&tree, &parents, i](){
+            for(size_t k = 0; k < per_thread; k++){
+                auto child = tree.concurrent_append_child(parents[i], i * per_thread + k);
+                if(k % 100 == 0){
+                    tree.concurrent_append_child(child, 0);
+                }
+            }
+        });
+    }
+    for(auto &w:workers){
+        w.join();
+    }
+    const size_t nested = per_thread / 100;
+    assert(tree.size() == 1 + (shared? 0 : threads) + threads * (per_thread + nested));
+    if(shared){
+        assert(check_children(root, threads, threads * per_thread));
+    }else{
+        for(auto &p:parents){
+            assert(check_children(p, threads, per_thread));
+        }
+    }
+}
+
+//threads start together and append to one parent, contents do not depend on interleaving
+void contention(size_t threads, size_t rounds){
+    const size_t count = 2000;
+    for(size_t round = 0; round < rounds; round++){
+        tree_ tree;
+        auto root = tree.set_root(0);
+        std::atomic<size_t> ready{0};
+        std::vector<std::thread> workers;
+        for(size_t i = 0; i < threads; i++){
+            workers.emplace_back([&tree, &root, &ready, threads, count, i](){
+                ready++;
+                while(ready.load() < threads){
+                    std::this_thread::yield();
+                }
+                for(size_t k = 0; k < count; k++){
+                    tree.concurrent_append_child(root, i * per_thread + k);
+                }
+            });
+        }
+        for(auto &w:workers){
+            w.join();
+        }
+        assert(tree.size() == 1 + threads * count);
+        std::vector<size_t> values, desired;
+        for(auto &v:tree.children(root)){
+            values.emplace_back(v);
+        }
+        for(size_t i = 0; i < threads; i++){
+            for(size_t k = 0; k < count; k++){
+                desired.emplace_back(i * per_thread + k);
+            }
+        }
+        std::sort(values.begin(), values.end());
+        assert(values == desired);
+        assert(check_children(root, threads, threads * count));
+    }
+}
+
+int main(){
+    contention(std::max<size_t>(8, 2 * std::thread::hardware_concurrency()), 5);
+    const size_t max_threads = std::max<size_t>(4, std::thread::hardware_concurrency());
+    for(size_t threads = 1; threads <= max_threads; threads *= 2){
+        run(threads, false);
+        run(threads, true);
+    }
+}
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <vector>
 #include <cassert>
 #include "k_tree.hpp"
 using tree_ = k_tree::tree<int>;
@@ -47,4 +48,26 @@ int main(){
     assert(copy == tree);
     auto rvalue = std::move(copy);
     assert(rvalue == tree);
+
+    //single node
+    tree_ single;
+    single.set_root(1);
+    tree_ single_copy = single;
+    assert(single_copy == single && single_copy.size() == 1);
+    auto single_root = single_copy.begin();
+    single_copy.append_child(single_root, 2);
+    assert(single.size() == 1 && single_copy.size() == 2);
+
+    //top level siblings are copied with their subtrees, in order
+    auto it8 = tree.insert_right(it0, 8);
+    tree.append_child(it8, 9);
+    tree.insert_right(it8, 10);
+    tree_ forest_copy;
+    forest_copy = tree;
+    assert(forest_copy == tree && forest_copy.size() == 11);
+    std::vector<int> desired = {0,1,2,6,3,4,5,7,8,9,10}, copied;
+    for(auto it = forest_copy.begin(); it != forest_copy.end(); it++){
+        copied.emplace_back(*it);
+    }
+    assert(copied == desired);
 }
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <vector>
+#include <random>
+#include <cassert>
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<int, k_tree::policy::cached_depth>;
+
+//depth by walking parent links
+size_t walk_depth(const tree_::iterator &it){
+    std::vector<tree_::iterator> path;
+    tree_::path_to_root(it, std::back_inserter(path));
+    return path.size() - 1;
+}
+
+bool check(const tree_ &tree){
+    for(auto it = tree.begin(); it != tree.end(); it++){
+        if(tree.depth(it) != walk_depth(it)){
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(){
+    /* 0-8
+       |
+       1-2-5
+         |
+         3-4
+    */
+    tree_ tree;
+    auto it0 = tree.set_root(0);
+    tree.append_child(it0, 1);
+    auto it2 = tree.append_child(it0, 2);
+    auto it3 = tree.append_child(it2, 3);
+    auto it4 = tree.append_child(it2, 4);
+    auto it5 = tree.append_child(it0, 5);
+    auto it8 = tree.insert_right(it0, 8);
+    assert(tree.depth(it0) == 0 && tree.depth(it8) == 0);
+    assert(tree.depth(it2) == 1 && tree.depth(it4) == 2);
+    assert(check(tree));
+
+    //path in both directions, caller-provided buffers
+    tree_::iterator buf[3];
+    assert(tree.path_to_root(it3, buf) == buf + 3);
+    assert(buf[0] == it3 && buf[1] == it2 && buf[2] == it0);
+    assert(tree.path_from_root(it3, buf) == buf + 3);
+    assert(buf[0] == it0 && buf[1] == it2 && buf[2] == it3);
+    assert(tree.path_from_root(it8, buf) == buf + 1 && buf[0] == it8);
+
+    //moves of subtrees update depth
+    tree.move_right(it5, it3);
+    assert(tree.depth(it5) == 2);
+    assert(check(tree));
+    tree.move_left(it2, it0);
+    assert(tree.depth(it2) == 0 && tree.depth(it4) == 1 && tree.depth(it5) == 1);
+    assert(check(tree));
+
+    //bulk inserts, erase_if, copies
+    std::vector<int> values = {10, 11, 12};
+    auto first = tree.append_children(it3, values.begin(), values.end());
+    assert(tree.depth(first) == 2);
+    tree.erase_if([](int val){ return val == 3; });
+    assert(tree.depth(first) == 1);
+    assert(check(tree));
+    tree_ copy = tree;
+    assert(check(copy));
+
+    //random churn
+    std::mt19937 gen(7);
+    std::vector<tree_::iterator> its;
+    for(auto it = tree.begin(); it != tree.end(); it++){
+        its.emplace_back(it);
+    }
+    for(int i = 0; i < 2000; i++){
+        auto &it = its[gen() % its.size()];
+        auto &pos = its[gen() % its.size()];
+        switch(gen() % 4){
+        case 0:
+            its.emplace_back(tree.append_child(it, i));
+            break;
+        case 1:
+            its.emplace_back(tree.insert_left(it, i));
+            break;
+        case 2:
+        {
+            bool is_ancestor = false;
+            for(auto n = pos.n; n; n = n->parent){
+                is_ancestor |= n == it.n;
+            }
+            if(!is_ancestor){
+                tree.move_right(it, pos);
+            }
+            break;
+        }
+        default:
+            tree.sort_children(it);
+            break;
+        }
+    }
+    assert(check(tree));
+    tree.compact();
+    assert(check(tree));
+}
@@ -0,0 +1,167 @@
+#include <iostream>
+#include <random>
+#include <cassert>
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<int>;
+using kind = k_tree::edit<int>::kind;
+
+void random_change(tree_ &tree, std::mt19937 &gen, int val){
+    std::uniform_int_distribution<int> op_dist(0, 6);
+    std::uniform_int_distribution<size_t> node_dist(0, tree.size()-1);
+    auto it = std::next(tree.begin(), node_dist(gen));
+    switch(op_dist(gen)){
+    case 0: tree.replace(it, val); break;
+    case 1: tree.insert_left(it, val); break;
+    case 2: tree.insert_right(it, val); break;
+    case 3: tree.append_child(it, val); break;
+    case 4: tree.prepend_child(it, val); break;
+    case 5:
+        if(tree.size() > 1){
+            tree.erase(it);
+        }
+        break;
+    case 6: tree.sort_children(it, std::greater<int>()); break;
+    }
+}
+
+//every value has the same hash, subtrees of one shape collide
+struct colliding_hash{
+    std::uint64_t operator()(int)const{
+        return 0;
+    }
+};
+
+int main(){
+    /* 0        0
+       |        |
+       1-2-3 -> 3-1-4
+         |        |
+         5        6
+     */
+    tree_ lhs;
+    auto it0 = lhs.set_root(0);
+    lhs.append_child(it0, 1);
+    auto it2 = lhs.append_child(it0, 2);
+    lhs.append_child(it0, 3);
+    lhs.append_child(it2, 5);
+    tree_ rhs;
+    auto rit0 = rhs.set_root(0);
+    rhs.append_child(rit0, 3);
+    auto rit1 = rhs.append_child(rit0, 1);
+    rhs.append_child(rit0, 4);
+    rhs.append_child(rit1, 6);
+
+    assert(k_tree::diff(lhs, lhs).empty());
+    auto script = k_tree::diff(lhs, rhs);
+    for(auto &e:script){
+        std::cout<<static_cast<int>(e.op)<<" [";
+        for(auto i:e.path){
+            std::cout<<i<<" ";
+        }
+        std::cout<<"] to:"<<e.to<<" val:"<<e.value<<std::endl;
+    }
+    bool moved = false;
+    for(auto &e:script){
+        moved = moved || e.op == kind::move;
+    }
+    assert(moved);
+    k_tree::apply_patch(lhs, script);
+    assert(lhs == rhs);
+
+    //empty trees
+    tree_ empty;
+    auto fill = k_tree::diff(empty, rhs);
+    k_tree::apply_patch(empty, fill);
+    assert(empty == rhs);
+    auto drain = k_tree::diff(rhs, tree_());
+    k_tree::apply_patch(rhs, drain);
+    assert(rhs.empty());
+
+    //colliding hashes are confirmed by values
+    tree_ clhs, crhs;
+    auto cit = clhs.set_root(0);
+    clhs.append_child(cit, 1);
+    auto cit2 = clhs.append_child(cit, 2);
+    clhs.append_child(cit2, 3);
+    clhs.insert_right(cit, 4);
+    auto crit = crhs.set_root(0);
+    crhs.append_child(crit, 1);
+    auto crit2 = crhs.append_child(crit, 5);
+    crhs.append_child(crit2, 6);
+    crhs.insert_right(crit, 7);
+    auto collided = k_tree::diff<colliding_hash>(clhs, crhs);
+    assert(collided.size() == 3);
+    k_tree::apply_patch(clhs, collided);
+    assert(clhs == crhs);
+    assert(k_tree::diff<colliding_hash>(clhs, crhs).empty());
+
+    //hand-written moves to the last place of siblings
+    tree_ order;
+    auto oit = order.set_root(0);
+    order.append_child(oit, 1);
+    order.append_child(oit, 2);
+    order.insert_right(oit, 3);
+    k_tree::patch<int> moves = {
+        {kind::move, {0}, 1, 0},
+        {kind::move, {1, 0}, 1, 0},
+        {kind::insert, {1, 2}, 0, 4},
+        {kind::erase, {0}, 0, 0}
+    };
+    k_tree::apply_patch(order, moves);
+    std::vector<int> desired = {0,2,1,4};
+    assert(std::vector<int>(order.begin(), order.end()) == desired);
+    assert(order.size() == 4 && *order.begin() == 0);
+
+    //many edits among children of one wide node
+    tree_ wide;
+    auto wit = wide.set_root(0);
+    for(int i = 0; i < 5000; i++){
+        auto child = wide.append_child(wit, i);
+        if(i % 100 == 0){
+            wide.append_child(child, -i);
+        }
+    }
+    tree_ wide_changed = wide;
+    auto wide_top = wide_changed.begin();
+    auto children = wide_changed.children(wide_top);
+    std::vector<tree_::sibling_iterator> wide_children;
+    for(auto child = children.begin(); child != children.end(); child++){
+        wide_children.emplace_back(child);
+    }
+    for(size_t i = 0; i < wide_children.size(); i++){
+        if(i % 7 == 0){
+            wide_changed.replace(wide_children[i], -1);
+        }else if(i % 11 == 0){
+            wide_changed.erase(wide_children[i]);
+        }else if(i % 13 == 0){
+            wide_changed.insert_left(wide_children[i], -2);
+        }
+    }
+    auto wide_script = k_tree::diff(wide, wide_changed);
+    k_tree::apply_patch(wide, wide_script);
+    assert(wide == wide_changed);
+    std::cout<<"wide edits:"<<wide_script.size()<<std::endl;
+
+    //random changes of a big tree make small scripts
+    std::mt19937 gen(1);
+    tree_ big;
+    auto root = big.set_root(0);
+    for(int i = 1; i < 1000; i++){
+        random_change(big, gen, i % 50);
+    }
+    big.append_child(root, -1);
+    for(int round = 0; round < 50; round++){
+        tree_ changed = big;
+        int changes = 1 + round % 5;
+        for(int i = 0; i < changes; i++){
+            random_change(changed, gen, 1000 + i);
+        }
+        auto script = k_tree::diff(big, changed);
+        tree_ patched = big;
+        k_tree::apply_patch(patched, script);
+        assert(patched == changed);
+        std::cout<<"changes:"<<changes<<"\tedits:"<<script.size()<<std::endl;
+    }
+    return 0;
+}
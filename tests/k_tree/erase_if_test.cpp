@@ -0,0 +1,118 @@
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<int>;
+
+auto collect(const tree_ &tree){
+    std::vector<int> result;
+    for(auto it = tree.begin(); it != tree.end(); it++){
+        std::cout<< *it << " ";
+        result.emplace_back(*it);
+    }
+    std::cout<<std::endl;
+    return result;
+}
+
+/* 0-8
+   |
+   1-2-5-7
+     |
+   6-3-4
+*/
+tree_ make_tree(){
+    tree_ tree;
+    auto it0 = tree.set_root(0);
+    tree.append_child(it0, 1);
+    auto it2 = tree.append_child(it0, 2);
+    auto it3 = tree.append_child(it2, 3);
+    tree.append_child(it2, 4);
+    auto it5 = tree.append_child(it0, 5);
+    tree.insert_left(it3, 6);
+    tree.insert_right(it5, 7);
+    tree.insert_right(it0, 8);
+    return tree;
+}
+
+int main(){
+    //erase_if promotes children
+    auto tree = make_tree();
+    assert(tree.erase_if([](int val){ return val == 2; }) == 1);
+    std::vector<int> desired = {0,1,6,3,4,5,7,8};
+    assert(collect(tree) == desired);
+    auto children = tree.children(tree.begin());
+    desired = {1,6,3,4,5,7};
+    assert(std::vector<int>(children.begin(), children.end()) == desired);
+    auto children_end = children.end();
+    assert(*(--children_end) == 7);
+
+    //erase_if of root and top level nodes
+    tree = make_tree();
+    assert(k_tree::erase_if(tree, [](int val){ return val == 0 || val == 2 || val == 8; }) == 3);
+    desired = {1,6,3,4,5,7};
+    assert(collect(tree) == desired);
+    assert(*tree.begin<tree_::sibling_iterator>() == 1);
+    assert(std::distance(tree.begin<tree_::sibling_iterator>(),
+        tree.end<tree_::sibling_iterator>()) == 6);
+    auto it1 = tree.begin();
+    tree.append_child(it1, 9);
+    desired = {1,9,6,3,4,5,7};
+    assert(collect(tree) == desired);
+
+    //odd values, nested matches
+    tree = make_tree();
+    assert(tree.erase_if([](int val){ return val % 2; }) == 4);
+    desired = {0,2,6,4,8};
+    assert(collect(tree) == desired);
+
+    //prune_if drops whole subtrees and counts all their nodes
+    tree = make_tree();
+    assert(k_tree::prune_if(tree, [](int val){ return val == 2 || val == 7; }) == 5);
+    desired = {0,1,5,8};
+    assert(collect(tree) == desired);
+    assert(tree.prune_if([](int val){ return val == 0; }) == 3);
+    desired = {8};
+    assert(collect(tree) == desired);
+    assert(tree.prune_if([](int){ return true; }) == 1);
+    assert(tree.empty());
+    tree.set_root(1);
+    assert(tree.size() == 1);
+
+    //nothing matches
+    tree = make_tree();
+    assert(tree.erase_if([](int){ return false; }) == 0);
+    assert(tree.prune_if([](int){ return false; }) == 0);
+    assert(tree == make_tree());
+
+    //half of a wide and deep tree in one pass
+    tree_ big;
+    auto it = big.set_root(0);
+    for(int i = 1; i < 100000; i++){
+        it = (i % 3)? big.append_child(it, i) : big.insert_right(it, i);
+    }
+    auto size = big.size();
+    auto erased = big.erase_if([](int val){ return val % 2; });
+    assert(erased == size / 2);
+    assert(big.size() == size - erased);
+    for(auto &val:big.dfs()){
+        assert(val % 2 == 0);
+    }
+    big.prune_if([](int){ return true; });
+    assert(big.empty());
+
+    //policies see the result of a batch
+    using hashed = k_tree::tree<int, k_tree::policy::merkle<>>;
+    hashed lhs, rhs;
+    auto l0 = lhs.set_root(0);
+    lhs.append_child(l0, 1);
+    auto l2 = lhs.append_child(l0, 2);
+    lhs.append_child(l2, 3);
+    auto r0 = rhs.set_root(0);
+    rhs.append_child(r0, 3);
+    lhs.erase_if([](int val){ return val == 1 || val == 2; });
+    assert(lhs.hash() == rhs.hash());
+    lhs.prune_if([](int val){ return val == 3; });
+    rhs.prune_if([](int val){ return val == 3; });
+    assert(lhs.hash() == rhs.hash());
+}
@@ -0,0 +1,190 @@
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <stdexcept>
+#include <cassert>
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<int, k_tree::policy::handles<>>;
+
+/* 0-8
+   |
+   1-2-5-7
+     |
+   6-3-4
+*/
+template<class Tree>
+Tree make_tree(){
+    Tree tree;
+    auto it0 = tree.set_root(0);
+    tree.append_child(it0, 1);
+    auto it2 = tree.append_child(it0, 2);
+    auto it3 = tree.append_child(it2, 3);
+    tree.append_child(it2, 4);
+    auto it5 = tree.append_child(it0, 5);
+    tree.insert_left(it3, 6);
+    tree.insert_right(it5, 7);
+    tree.insert_right(it0, 8);
+    return tree;
+}
+
+template<class Tree>
+auto handles_of(Tree &tree){
+    //values of nodes are 0..size-1, handles are indexed by them
+    std::vector<typename Tree::handle_type> result(tree.size());
+    for(auto it = tree.begin(); it != tree.end(); it++){
+        result[*it] = tree.handle(it);
+    }
+    return result;
+}
+
+template<class Tree>
+void check(Tree &tree, const std::vector<typename Tree::handle_type> &handles){
+    for(size_t i = 0; i < handles.size(); i++){
+        auto it = tree.resolve(handles[i]);
+        std::cout<< *it << " ";
+        assert(tree.valid(handles[i]));
+        assert(*it == int(i));
+    }
+    std::cout<<std::endl;
+}
+
+int main(){
+    //handles resolve to their nodes, repeated calls give the same handle
+    auto tree = make_tree<tree_>();
+    auto handles = handles_of(tree);
+    check(tree, handles);
+    auto it2 = tree.resolve(handles[2]);
+    assert(tree.handle(it2) == handles[2]);
+    assert(!tree.valid(tree_::handle_type()));
+    assert(tree.resolve(tree_::handle_type()) == tree.end());
+
+    //handles survive moves of nodes, sorting and compaction
+    auto it7 = tree.resolve(handles[7]);
+    tree.move_left(it7, it2);
+    tree.sort_subtree(tree.begin(), std::greater<int>());
+    tree.compact();
+    check(tree, handles);
+
+    //and moves of a tree
+    tree_ moved(std::move(tree));
+    check(moved, handles);
+    tree = std::move(moved);
+    check(tree, handles);
+
+    //erased nodes have stale handles, slots are reused with a new generation
+    auto it5 = tree.resolve(handles[5]);
+    tree.erase(it5);
+    assert(!tree.valid(handles[5]));
+    assert(tree.resolve(handles[5]) == tree.end());
+    tree.erase_if([](int val){ return val == 3; });
+    tree.prune_if([](int val){ return val == 8; });
+    assert(!tree.valid(handles[3]) && !tree.valid(handles[8]));
+    auto it4 = tree.resolve(handles[4]);
+    assert(*it4 == 4);
+    auto it9 = tree.append_child(it4, 9);
+    auto h9 = tree.handle(it9);
+    assert(h9.slot() == handles[8].slot() && h9 != handles[8]);
+    assert(tree.valid(h9) && !tree.valid(handles[8]));
+    assert(*tree.resolve(h9) == 9);
+
+    //erase releases whole subtree, also children of a last child
+    {
+        tree_ deep;
+        auto top = deep.set_root(0);
+        deep.append_child(top, 1);
+        auto last = deep.append_child(top, 2);
+        auto grandchild = deep.append_child(last, 3);
+        deep.append_child(grandchild, 4);
+        auto right = deep.insert_right(top, 5);
+        auto deep_handles = handles_of(deep);
+        deep.erase(top);
+        assert(deep.size() == 1 && *deep.begin() == 5);
+        for(int i = 0; i < 5; i++){
+            assert(!deep.valid(deep_handles[i]));
+            assert(deep.resolve(deep_handles[i]) == deep.end());
+        }
+        assert(deep.valid(deep_handles[5]) && deep.resolve(deep_handles[5]) == right);
+    }
+
+    //handles as keys
+    std::unordered_map<tree_::handle_type, int> marks;
+    for(auto it = tree.begin(); it != tree.end(); it++){
+        marks[tree.handle(it)] = *it * 10;
+    }
+    assert(marks.at(handles[4]) == 40);
+    assert(marks.at(h9) == 90);
+    assert(!marks.count(handles[5]));
+
+    //copies do not share handles
+    tree_ copy(tree);
+    assert(*copy.begin() == *tree.begin());
+    assert(!copy.valid(h9));
+    tree.clear();
+    for(auto &h:handles){
+        assert(!tree.valid(h));
+    }
+    assert(!tree.valid(h9));
+
+    //compact 32-bit handles with 24-bit slots by default
+    using small = k_tree::tree<int, k_tree::policy::handles<std::uint32_t>>;
+    static_assert(sizeof(small::handle_type) == 4, "");
+    static_assert(small::handle_type::slot_mask == 0xFFFFFF, "");
+    auto stree = make_tree<small>();
+    auto shandles = handles_of(stree);
+    auto sit = stree.resolve(shandles[3]);
+    assert(*sit == 3);
+    for(int i = 0; i < 1000; i++){
+        auto it = stree.append_child(sit, i);
+        auto h = stree.handle(it);
+        assert(h.slot() == shandles.size());
+        stree.erase(it);
+        assert(!stree.valid(h));
+    }
+    assert(*stree.resolve(shandles[3]) == 3);
+    assert(stree.size() == 9);
+
+    //running out of slots throws instead of reusing a slot of a live node
+    using tiny = k_tree::tree<int, k_tree::policy::handles<std::uint16_t, 4>>;
+    tiny ttree;
+    auto tit = ttree.set_root(0);
+    std::vector<tiny::handle_type> thandles = {ttree.handle(tit)};
+    for(int i = 1; i < 16; i++){
+        thandles.push_back(ttree.handle(ttree.append_child(tit, i)));
+    }
+    auto extra = ttree.append_child(tit, 16);
+    bool thrown = false;
+    try{
+        ttree.handle(extra);
+    }catch(const std::length_error&){
+        thrown = true;
+    }
+    assert(thrown);
+    for(size_t i = 0; i < thandles.size(); i++){
+        assert(*ttree.resolve(thandles[i]) == int(i));
+    }
+    //an erased node frees a slot for the next handle
+    ttree.erase(ttree.resolve(thandles[5]));
+    auto h16 = ttree.handle(extra);
+    assert(h16.slot() == thandles[5].slot() && *ttree.resolve(h16) == 16);
+    assert(!ttree.valid(thandles[5]));
+
+    //freed slots match no handle, also after generations wrap around
+    using narrow = k_tree::tree<int, k_tree::policy::handles<std::uint8_t, 5>>;
+    narrow ntree;
+    auto nit = ntree.set_root(0);
+    assert(!ntree.valid(narrow::handle_type()));
+    std::vector<narrow::handle_type> nhandles;
+    for(int i = 0; i < 20; i++){
+        auto it = ntree.append_child(nit, i);
+        nhandles.push_back(ntree.handle(it));
+        assert(nhandles.back().slot() == 0 && ntree.valid(nhandles.back()));
+        ntree.erase(it);
+        for(auto h:nhandles){
+            assert(!ntree.valid(h) && ntree.resolve(h) == ntree.end());
+        }
+        assert(!ntree.valid(narrow::handle_type()));
+    }
+    assert(nhandles[1] == nhandles[4]);
+}
@@ -0,0 +1,91 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<int>;
+
+template<class It>
+auto collect(It it, It end){
+    std::vector<int> result;
+    for(; it != end; it++){
+        std::cout<< *it << " ";
+        result.emplace_back(*it);
+    }
+    std::cout<<std::endl;
+    return result;
+}
+
+template<class It>
+auto collect_back(It begin, It it){
+    std::vector<int> result;
+    while(it != begin){
+        it--;
+        result.emplace_back(*it);
+    }
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+int main(){
+    /* 0-8
+       |
+       1-2-5-7
+         |
+       6-3-4
+       post-order: 1 6 3 4 2 5 7 0 8
+       leaves: 1 6 3 4 5 7 8
+    */
+    tree_ tree;
+    auto it0 = tree.set_root(0);
+    tree.append_child(it0, 1);
+    auto it2 = tree.append_child(it0, 2);
+    auto it3 = tree.append_child(it2, 3);
+    tree.append_child(it2, 4);
+    auto it5 = tree.append_child(it0, 5);
+    tree.insert_left(it3, 6);
+    tree.insert_right(it5, 7);
+    tree.insert_right(it0, 8);
+
+    std::vector<int> desired = {1,6,3,4,2,5,7,0,8};
+    assert(collect(tree.begin_post(), tree.end_post()) == desired);
+    assert(collect_back(tree.begin_post(), tree.end_post()) == desired);
+
+    desired = {1,6,3,4,5,7,8};
+    assert(collect(tree.begin_leaf(), tree.end_leaf()) == desired);
+    assert(collect_back(tree.begin_leaf(), tree.end_leaf()) == desired);
+    assert(std::count_if(tree.begin_leaf(), tree.end_leaf(),
+        [](int val){ return val > 4; }) == 4);
+
+    auto children = tree.children(it0);
+    desired = {1,2,5,7};
+    assert(collect(children.begin(), children.end()) == desired);
+    assert(collect_back(children.begin(), children.end()) == desired);
+    std::vector<int> result;
+    for(auto &val:tree.children(it2)){
+        result.emplace_back(val);
+    }
+    desired = {6,3,4};
+    assert(result == desired);
+    std::reverse(children.begin(), children.end());
+    desired = {7,5,2,1};
+    assert(collect(children.begin(), children.end()) == desired);
+    assert(std::find(children.begin(), children.end(), 2) == tree_::sibling_iterator(it5));
+
+    //top level siblings
+    desired = {0,8};
+    auto top = tree.begin<tree_::sibling_iterator>();
+    auto top_end = tree.end<tree_::sibling_iterator>();
+    assert(collect(top, top_end) == desired);
+    assert(collect_back(top, top_end) == desired);
+
+    //single node
+    tree_ single;
+    single.set_root(1);
+    desired = {1};
+    assert(collect(single.begin_post(), single.end_post()) == desired);
+    assert(collect(single.begin_leaf(), single.end_leaf()) == desired);
+    assert(single.children(single.begin()).begin() == single.children(single.begin()).end());
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cassert>
+#include "k_tree.hpp"
+
+struct entry{
+    std::string name;
+    int size;
+    bool operator==(const entry &rhs)const{
+        return name == rhs.name && size == rhs.size;
+    }
+    bool operator!=(const entry &rhs)const{
+        return !(*this == rhs);
+    }
+};
+
+struct name_of{
+    const std::string& operator()(const entry &e)const{
+        return e.name;
+    }
+};
+
+using fs = k_tree::tree<entry, k_tree::policy::keyed<std::string, name_of>>;
+using trie = k_tree::tree<char, k_tree::policy::keyed<char>>;
+using wide = k_tree::tree<int, k_tree::policy::keyed<int, k_tree::policy::identity, std::hash<int>, 4>>;
+
+void insert_word(trie &t, const std::string &word){
+    auto it = t.end();
+    for(auto c:word){
+        auto next = (it == t.end())? t.find_path(c) : t.find_child(it, c);
+        if(next == t.end()){
+            if(it == t.end()){
+                auto top = t.begin();
+                next = t.empty()? t.set_root(c) : t.insert_left(top, c);
+            }else{
+                next = t.append_child(it, c);
+            }
+        }
+        it = next;
+    }
+}
+
+int main(){
+    fs tree;
+    auto root = tree.set_root(entry{"usr", 0});
+    auto etc = tree.insert_right(root, entry{"etc", 0});
+    auto lib = tree.append_child(root, entry{"lib", 0});
+    auto bin = tree.append_child(root, entry{"bin", 0});
+    tree.append_child(bin, entry{"ls", 10});
+    tree.append_child(bin, entry{"cat", 20});
+    tree.append_child(etc, entry{"hosts", 1});
+
+    assert(tree.find_child(root, std::string("bin")) == bin);
+    assert(tree.find_child(root, std::string("sbin")) == tree.end());
+    assert(tree.find_child(tree.find_path("etc"), std::string("hosts"))->size == 1);
+    assert(tree.find_path("usr", "bin", "cat")->size == 20);
+    assert(tree.find_path("usr", "lib") == lib);
+    assert(tree.find_path("usr", "bin", "cp") == tree.end());
+    assert(tree.find_path("home") == tree.end());
+    std::vector<std::string> path = {"usr", "bin", "ls"};
+    assert(tree.find_path(path.begin(), path.end())->size == 10);
+    //empty path names no node
+    assert(tree.find_path() == tree.end());
+    assert(tree.find_path(path.end(), path.end()) == tree.end());
+
+    //renames, moves and erases keep indices
+    tree.modify(lib, [](entry &e){ e.name = "lib64"; });
+    assert(tree.find_path("usr", "lib") == tree.end());
+    assert(tree.find_path("usr", "lib64") == lib);
+    tree.move_right(bin, etc);
+    assert(tree.find_path("usr", "bin") == tree.end());
+    assert(tree.find_path("bin", "ls")->size == 10);
+    tree.erase(tree.find_path("bin", "ls"));
+    assert(tree.find_path("bin", "ls") == tree.end());
+    assert(tree.find_path("bin", "cat")->size == 20);
+    tree.replace(tree.find_path("etc"), entry{"config", 0});
+    assert(tree.find_path("config", "hosts")->size == 1);
+
+    //rebuilds: copy, sort, erase_if, compact
+    fs copy = tree;
+    assert(copy.find_path("bin", "cat")->size == 20);
+    assert(copy.find_path("config", "hosts") != tree.find_path("config", "hosts"));
+    copy.sort_children(copy.find_path("usr"), [](const entry &l, const entry &r){
+        return l.name > r.name;
+    });
+    assert(copy.find_path("usr", "lib64") != copy.end());
+    copy.erase_if([](const entry &e){ return e.name == "config"; });
+    assert(copy.find_path("hosts")->size == 1);
+    copy.compact();
+    assert(copy.find_path("hosts")->size == 1);
+    assert(copy.find_path("bin", "cat")->size == 20);
+    fs moved(std::move(copy));
+    assert(moved.find_path("hosts")->size == 1);
+    assert(copy.find_path("hosts") == copy.end());
+    moved.clear();
+    assert(moved.find_path("hosts") == moved.end());
+
+    //trie of words
+    trie words;
+    for(auto w:{"tree", "trie", "try", "top", "a", "an"}){
+        insert_word(words, w);
+    }
+    assert(words.size() == 11);
+    std::string key = "tri";
+    auto it = words.find_path(key.begin(), key.end());
+    assert(it != words.end() && *it == 'i');
+    assert(*words.find_child(it, 'e') == 'e');
+    assert(words.find_path('t', 'r', 'e', 'e') != words.end());
+    assert(words.find_path('t', 'r', 'e', 'x') == words.end());
+    assert(words.find_path('a', 'n') != words.end());
+
+    //children are scanned below threshold and indexed from it
+    wide w;
+    auto top = w.set_root(-1);
+    for(int i = 0; i < 10; i++){
+        w.append_child(top, i);
+        for(int j = 0; j <= i; j++){
+            assert(*w.find_child(top, j) == j);
+        }
+        assert(w.find_child(top, 10) == w.end());
+    }
+    for(int i = 1; i < 6; i++){
+        w.insert_right(top, 100 + i);
+    }
+    for(int i = 1; i < 6; i++){
+        assert(*w.find_path(100 + i) == 100 + i);
+    }
+    assert(*w.find_path(-1, 7) == 7);
+    //sorting keeps keys, erases drop an index below a half of threshold
+    w.sort_subtree(top, std::greater<int>());
+    assert(*w.children(top).begin() == 9);
+    for(int i = 0; i < 10; i++){
+        assert(*w.find_path(-1, i) == i);
+    }
+    for(int i = 9; i >= 0; i--){
+        w.erase(w.find_child(top, i));
+        assert(w.find_child(top, i) == w.end());
+        for(int j = 0; j < i; j++){
+            assert(*w.find_child(top, j) == j);
+        }
+    }
+    w.modify(w.find_path(103), [](int &v){ v = 42; });
+    assert(w.find_path(103) == w.end() && *w.find_path(42) == 42);
+    wide w_copy = w;
+    assert(*w_copy.find_path(105) == 105 && w_copy.find_path(103) == w_copy.end());
+}
@@ -0,0 +1,191 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <algorithm>
+#include <type_traits>
+#include <cassert>
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<int, k_tree::policy::merkle<>>;
+
+//copy recomputes all hashes from scratch
+void check_hashes(const tree_ &tree){
+    tree_ copy = tree;
+    assert(copy.hash() == tree.hash());
+    auto cit = copy.begin();
+    for(auto it = tree.begin(); it != tree.end(); it++, cit++){
+        assert(tree.subtree_hash(it) == copy.subtree_hash(cit));
+    }
+}
+
+int main(){
+    /* 0
+       |
+       1-2-5
+         |
+         3-4
+     */
+    tree_ lhs;
+    auto it0 = lhs.set_root(0);
+    lhs.append_child(it0, 1);
+    auto it2 = lhs.append_child(it0, 2);
+    lhs.append_child(it2, 3);
+    lhs.append_child(it2, 4);
+    lhs.append_child(it0, 5);
+
+    //same tree, built in other order
+    tree_ rhs;
+    auto rit0 = rhs.set_root(0);
+    auto rit5 = rhs.append_child(rit0, 5);
+    auto rit2 = rhs.insert_left(rit5, 2);
+    rhs.prepend_child(rit0, 1);
+    auto rit4 = rhs.append_child(rit2, 4);
+    rhs.insert_left(rit4, 3);
+    assert(lhs.hash() == rhs.hash());
+    assert(lhs == rhs);
+    check_hashes(rhs);
+
+    //value change is seen up to a root and reverts back
+    auto old = rhs.hash();
+    rhs.replace(rit4, 40);
+    assert(rhs.hash() != old);
+    assert(lhs != rhs);
+    check_hashes(rhs);
+    rhs.modify(rit4, [](int &val){ val /= 10; });
+    assert(rhs.hash() == old);
+
+    //order of children matters
+    rhs.sort_children(rit2, std::greater<int>());
+    assert(rhs.hash() != old);
+    check_hashes(rhs);
+    rhs.sort_subtree(rit0);
+    assert(rhs.hash() == old);
+
+    //erase and insert back
+    rhs.erase(rit2);
+    assert(rhs.hash() != old);
+    check_hashes(rhs);
+    rit2 = rhs.insert_left(rit5, 2);
+    std::vector<int> children = {3,4};
+    rhs.append_children(rit2, children.begin(), children.end());
+    assert(rhs.hash() == old);
+
+    //top level siblings
+    auto top = rhs.insert_right(rit0, 6);
+    assert(rhs.hash() != old);
+    check_hashes(rhs);
+    rhs.erase(top);
+    assert(rhs.hash() == old);
+
+    //identical subtrees share a bucket
+    auto it6 = lhs.append_child(it0, 2);
+    lhs.append_child(it6, 3);
+    lhs.append_child(it6, 4);
+    auto index = lhs.subtree_index();
+    auto range = index.equal_range(lhs.subtree_hash(it2));
+    assert(std::distance(range.first, range.second) == 2);
+    for(auto it = range.first; it != range.second; it++){
+        assert(tree_::equal_subtrees(it->second, it2));
+    }
+    assert(!tree_::equal_subtrees(it0, it2));
+
+    //writes through mutable iterators make hashes stale, they are rehashed
+    tree_ wlhs = rhs, wrhs = rhs;
+    assert(wlhs == wrhs);
+    auto wit = std::next(wlhs.begin(), 3);
+    *wit = 30;
+    assert(wlhs.hash() != wrhs.hash());
+    assert(wlhs != wrhs);
+    check_hashes(wlhs);
+    *wit = 3;
+    assert(wlhs.hash() == wrhs.hash());
+    assert(wlhs == wrhs);
+    //stale subtree moved under a fresh node
+    auto wit1 = std::next(wlhs.begin(), 1);
+    auto wit2 = std::next(wlhs.begin(), 2);
+    auto wit5 = std::next(wlhs.begin(), 5);
+    auto wit6 = wlhs.append_child(wit5, 6);
+    wlhs.subtree_hash(wit5);
+    *wit = 33;
+    wlhs.move_left(wit2, wit6);
+    check_hashes(wlhs);
+    wlhs.move_right(wit2, wit1);
+    wlhs.erase(wit6);
+    wlhs.replace(wit, 3);
+    assert(wlhs == wrhs);
+    //stale top level node is erased
+    auto wroot = wlhs.begin();
+    auto wtop = wlhs.insert_right(wroot, 7);
+    auto wtop_child = wlhs.append_child(wtop, 8);
+    wlhs.subtree_hash(wtop);
+    *wtop_child = 9;
+    wlhs.erase(wtop);
+    assert(wlhs.hash() == wrhs.hash());
+    //subtree hash and frozen ranges
+    auto frozen = wlhs.freeze();
+    frozen[4] = 40;
+    assert(wlhs.subtree_hash(wit2) != wrhs.subtree_hash(std::next(wrhs.begin(), 2)));
+    assert(!tree_::equal_subtrees(wit2, std::next(wrhs.begin(), 2)));
+    std::for_each(frozen.begin(), frozen.end(), [](int &val){ val *= 2; });
+    check_hashes(wlhs);
+    std::for_each(frozen.begin(), frozen.end(), [](int &val){ val /= 2; });
+    frozen[4] = 4;
+    assert(wlhs == wrhs);
+    //const iterators keep hashes fresh
+    const tree_ &cwlhs = wlhs;
+    int sum = 0;
+    for(auto it = cwlhs.cbegin(); it != cwlhs.cend(); it++){
+        sum += *it;
+    }
+    assert(sum == 15 && wlhs.hash() == wrhs.hash());
+    //so do plain iterators of a const tree
+    static_assert(std::is_same<decltype(*cwlhs.begin()), const int&>::value);
+    static_assert(std::is_same<decltype(*cwlhs.end<tree_::breadth_first_iterator>()), const int&>::value);
+    for(auto &val:cwlhs){
+        sum -= val;
+    }
+    assert(sum == 0 && wlhs.hash() == wrhs.hash());
+
+    //values of a separated storage
+    using separated = k_tree::tree<int, k_tree::policy::merkle<>, k_tree::policy::separate_values>;
+    separated slhs, srhs;
+    auto sit = slhs.set_root(1);
+    slhs.append_child(sit, 2);
+    auto srit = srhs.set_root(1);
+    srhs.append_child(srit, 2);
+    for(auto &val:slhs.values()){
+        val += 10;
+    }
+    assert(slhs != srhs);
+    for(auto &val:slhs.values()){
+        val -= 10;
+    }
+    assert(slhs == srhs && slhs.hash() == srhs.hash());
+
+    //random changes keep hashes consistent
+    k_tree::tree<std::string, k_tree::policy::merkle<>> random;
+    random.set_root("root");
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> op_dist(0, 5);
+    for(int i = 0; i < 2000; i++){
+        std::uniform_int_distribution<size_t> node_dist(0, random.size()-1);
+        auto it = std::next(random.begin(), node_dist(gen));
+        auto val = std::to_string(i % 17);
+        switch(op_dist(gen)){
+        case 0: random.replace(it, val); break;
+        case 1: random.insert_left(it, val); break;
+        case 2: random.insert_right(it, val); break;
+        case 3: random.append_child(it, val); break;
+        case 4: random.prepend_child(it, val); break;
+        case 5:
+            if(it != random.begin()){
+                random.erase(it);
+            }
+            break;
+        }
+    }
+    decltype(random) copy = random;
+    assert(copy.hash() == random.hash());
+    assert(copy == random);
+    return 0;
+}
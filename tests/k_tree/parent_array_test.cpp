@@ -0,0 +1,123 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <cassert>
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<int>;
+const auto npos = tree_::npos;
+
+int main(){
+    /* 0-8
+       |
+       1-2-5
+         |
+         3-4
+       indices are shuffled, siblings go in order of indices
+    */
+    std::vector<size_t> parents = {npos, 4, 0, npos, 0, 4, 0};
+    std::vector<int> values =     {0,    3, 1, 8,    2, 4, 5};
+    auto tree = tree_::from_parent_array(parents, values);
+    //threads are given explicitly, so split of work runs on any machine
+    for(size_t threads:{2, 3, 10}){
+        assert(tree_::from_parent_array(parents, values, threads) == tree);
+    }
+    std::vector<int> desired = {0,1,2,3,4,5,8};
+    assert(std::vector<int>(tree.cbegin(), tree.cend()) == desired);
+    auto it2 = std::next(tree.begin(), 2);
+    auto children = tree.children(it2);
+    desired = {3,4};
+    assert(std::vector<int>(children.begin(), children.end()) == desired);
+
+    //export in depth-first order, parents go first
+    std::vector<size_t> out_parents;
+    std::vector<int> out_values;
+    tree.to_parent_array(std::back_inserter(out_parents), std::back_inserter(out_values));
+    std::vector<size_t> desired_parents = {npos, 0, 0, 2, 2, 0, npos};
+    assert(out_parents == desired_parents);
+    assert(out_values == std::vector<int>(tree.cbegin(), tree.cend()));
+    assert(tree_::from_parent_array(out_parents, out_values) == tree);
+
+    //empty and single node
+    assert(tree_::from_parent_array(std::vector<size_t>(), std::vector<int>()).empty());
+    auto single = tree_::from_parent_array(std::vector<size_t>{npos}, std::vector<int>{7});
+    assert(single.size() == 1 && *single.begin() == 7);
+    auto it = single.begin();
+    single.append_child(it, 8);
+    assert(single.size() == 2);
+
+    //values are moved from rvalues
+    std::vector<std::string> strings = {"a", "b"};
+    auto moved = k_tree::tree<std::string>::from_parent_array(
+        std::vector<size_t>{npos, 0}, std::move(strings));
+    assert(*moved.begin() == "a" && *std::next(moved.begin()) == "b");
+
+    //big random forest, built over threads, matches one built by appends
+    const size_t count = 200000;
+    std::mt19937 gen(3);
+    parents.assign(count, npos);
+    values.resize(count);
+    for(size_t i = 0; i < count; i++){
+        values[i] = static_cast<int>(i);
+    }
+    std::vector<size_t> perm(count);
+    for(size_t i = 0; i < count; i++){
+        perm[i] = i;
+    }
+    std::shuffle(perm.begin(), perm.end(), gen);
+    //perm[i] has parent perm[j] for some j < i, so there are no cycles
+    for(size_t i = 1; i < count; i++){
+        if(gen() % 100){
+            parents[perm[i]] = perm[gen() % i];
+        }
+    }
+    auto big = tree_::from_parent_array(parents, values);
+    tree_ expected;
+    std::vector<tree_::iterator> its(count);
+    std::vector<std::vector<size_t>> kids(count);
+    std::vector<size_t> top;
+    for(size_t i = 0; i < count; i++){
+        (parents[i] == npos? top : kids[parents[i]]).emplace_back(i);
+    }
+    tree_::iterator last;
+    for(auto i:top){
+        its[i] = last.n? expected.insert_right(last, values[i]) : expected.set_root(values[i]);
+        last = its[i];
+    }
+    for(size_t k = 0; k < top.size(); k++){
+        std::vector<size_t> stack = {top[k]};
+        while(!stack.empty()){
+            auto p = stack.back();
+            stack.pop_back();
+            for(auto c:kids[p]){
+                its[c] = expected.append_child(its[p], values[c]);
+                stack.emplace_back(c);
+            }
+        }
+    }
+    assert(big.size() == count);
+    assert(big == expected);
+    for(size_t threads:{1, 2, 5}){
+        assert(tree_::from_parent_array(parents, values, threads) == expected);
+    }
+    out_parents.clear();
+    out_values.clear();
+    big.to_parent_array(std::back_inserter(out_parents), std::back_inserter(out_values));
+    assert(tree_::from_parent_array(out_parents, out_values) == big);
+
+    //star, one parent with all children, which keep order of indices
+    parents.assign(count, 0);
+    parents[0] = npos;
+    parents[count / 2] = npos;
+    auto star = tree_::from_parent_array(parents, values, 4);
+    auto center = star.begin();
+    auto star_children = star.children(center);
+    assert(static_cast<size_t>(std::distance(star_children.begin(), star_children.end())) == count - 2);
+    int prev = 0;
+    for(auto val:star_children){
+        assert(val > prev && val != int(count / 2));
+        prev = val;
+    }
+    assert(*std::prev(star.end()) == int(count / 2));
+}
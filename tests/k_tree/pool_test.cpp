@@ -0,0 +1,129 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#include <cassert>
+#include "k_tree.hpp"
+
+static std::atomic<size_t> heap_counter{0};
+
+void* operator new(std::size_t size){
+    heap_counter++;
+    if(auto p = std::malloc(size? size : 1)){
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p)noexcept{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t)noexcept{
+    std::free(p);
+}
+
+using tree_ = k_tree::tree<int>;
+
+//destroyed after thread-local pool of main thread
+static tree_ static_tree;
+
+tree_ make_small(int seed){
+    tree_ tree;
+    auto it = tree.set_root(seed);
+    tree.append_child(it, seed + 1);
+    auto it2 = tree.append_child(it, seed + 2);
+    tree.append_child(it2, seed + 3);
+    tree.insert_right(it, seed + 4);
+    return tree;
+}
+
+int main(){
+    //empty tree costs no allocations
+    size_t before = heap_counter;
+    {
+        tree_ empty;
+        tree_ moved(std::move(empty));
+        assert(moved.empty() && empty.empty());
+    }
+    assert(heap_counter == before);
+
+    //short-lived trees recycle nodes of each other
+    make_small(0);
+    before = heap_counter;
+    for(int i = 0; i < 100000; i++){
+        auto tree = make_small(i);
+        assert(tree.size() == 5);
+        tree.clear();
+        assert(tree.empty());
+        tree.set_root(i);
+    }
+    std::cout<< "allocations: " << heap_counter - before << std::endl;
+    assert(heap_counter == before);
+
+    //moves keep embedded foot consistent
+    auto lhs = make_small(10);
+    tree_ rhs(std::move(lhs));
+    assert(lhs.empty() && rhs.size() == 5);
+    assert(std::distance(rhs.begin<tree_::sibling_iterator>(),
+        rhs.end<tree_::sibling_iterator>()) == 2);
+    lhs = std::move(rhs);
+    assert(rhs.empty() && lhs.size() == 5);
+    lhs = std::move(lhs);
+    assert(lhs.size() == 5);
+    rhs = make_small(10);
+    assert(lhs == rhs);
+    auto top = rhs.set_root(1);
+    rhs.insert_right(top, 2);
+    assert(rhs.size() == 6);
+    lhs.clear();
+    lhs.set_root(3);
+    assert(*std::prev(lhs.end()) == 3);
+
+    //trees outlive threads they were built in
+    std::vector<tree_> trees(4);
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 4; i++){
+        threads.emplace_back([&trees, i](){
+            for(int j = 0; j < 1000; j++){
+                auto tree = make_small(j);
+                if(j % 10 == 0){
+                    trees[i] = std::move(tree);
+                }
+            }
+        });
+    }
+    for(auto &thread:threads){
+        thread.join();
+    }
+    for(auto &tree:trees){
+        assert(tree == make_small(990));
+    }
+    trees.clear();
+
+    //thread-local trees are destroyed after a pool of their thread
+    std::thread([](){
+        thread_local tree_ local_tree;
+        local_tree = make_small(5);
+        auto top = local_tree.begin();
+        auto it = local_tree.append_child(top, 10);
+        local_tree.append_child(it, 11);
+        assert(local_tree.size() == 7);
+    }).join();
+    static_tree = make_small(20);
+    auto static_top = static_tree.begin();
+    static_tree.append_child(static_top, 30);
+    assert(static_tree.size() == 6);
+
+    //merkle data of top level moves with a tree
+    using hashed = k_tree::tree<int, k_tree::policy::merkle<>>;
+    hashed h;
+    auto it = h.set_root(1);
+    h.insert_right(it, 2);
+    auto hash = h.hash();
+    hashed h2(std::move(h));
+    assert(h2.hash() == hash);
+    assert(h.hash() == hashed().hash());
+}
@@ -0,0 +1,144 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <iterator>
+#include <type_traits>
+#include <cassert>
+#ifdef HAS_TBB
+#include <execution>
+#endif
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<int>;
+
+template<class Range>
+auto collect(const Range &range){
+    std::vector<int> result;
+    for(auto &val:range){
+        std::cout<< val << " ";
+        result.emplace_back(val);
+    }
+    std::cout<<std::endl;
+    return result;
+}
+
+static_assert(std::is_same<
+    std::iterator_traits<tree_::depth_first_iterator>::iterator_category,
+    std::bidirectional_iterator_tag>::value, "");
+static_assert(std::is_same<
+    std::iterator_traits<tree_::frozen_range::iterator>::iterator_category,
+    std::random_access_iterator_tag>::value, "");
+static_assert(std::is_same<
+    decltype(*std::declval<tree_::const_iterator>()), const int&>::value, "");
+
+//const iterators give read-only values, also when an iterator itself is const
+template<class It>
+constexpr bool read_only =
+    std::is_same<decltype(*std::declval<const It&>()), const int&>::value &&
+    std::is_same<decltype(std::declval<const It&>().operator->()), const int*>::value &&
+    std::is_same<typename std::iterator_traits<It>::reference, const int&>::value;
+static_assert(read_only<tree_::const_depth_first_iterator>, "");
+static_assert(read_only<tree_::const_depth_first_reverse_iterator>, "");
+static_assert(read_only<tree_::const_breadth_first_iterator>, "");
+static_assert(read_only<tree_::const_post_order_iterator>, "");
+static_assert(read_only<tree_::const_leaf_iterator>, "");
+static_assert(read_only<tree_::const_sibling_iterator>, "");
+static_assert(read_only<decltype(std::declval<const tree_&>().bfs().begin())>, "");
+static_assert(read_only<tree_::const_frozen_range::iterator>, "");
+static_assert(std::is_same<decltype(std::declval<const tree_&>().freeze()[0]), const int&>::value, "");
+static_assert(std::is_same<decltype(std::declval<tree_&>().freeze()[0]), int&>::value, "");
+static_assert(read_only<decltype(std::declval<const tree_&>().children(
+    std::declval<tree_::iterator>()).begin())>, "");
+
+#ifdef __cpp_lib_ranges
+static_assert(std::bidirectional_iterator<tree_::depth_first_iterator>);
+static_assert(std::bidirectional_iterator<tree_::const_depth_first_iterator>);
+static_assert(std::forward_iterator<tree_::breadth_first_iterator>);
+static_assert(std::bidirectional_iterator<tree_::post_order_iterator>);
+static_assert(std::bidirectional_iterator<tree_::leaf_iterator>);
+static_assert(std::bidirectional_iterator<tree_::sibling_iterator>);
+static_assert(std::random_access_iterator<tree_::frozen_range::iterator>);
+static_assert(std::random_access_iterator<tree_::const_frozen_range::iterator>);
+static_assert(std::ranges::view<tree_::range<tree_::depth_first_iterator>>);
+static_assert(std::ranges::view<tree_::range<tree_::const_leaf_iterator>>);
+#endif
+
+int main(){
+    /* 0-8
+       |
+       1-2-5
+         |
+         3-4
+    */
+    tree_ tree;
+    auto it0 = tree.set_root(0);
+    tree.append_child(it0, 1);
+    auto it2 = tree.append_child(it0, 2);
+    tree.append_child(it2, 3);
+    tree.append_child(it2, 4);
+    tree.append_child(it0, 5);
+    tree.insert_right(it0, 8);
+
+    std::vector<int> desired = {0,1,2,3,4,5,8};
+    assert(collect(tree.dfs()) == desired);
+    const tree_ &ctree = tree;
+    assert(collect(ctree.dfs()) == desired);
+    assert(std::vector<int>(ctree.cbegin(), ctree.cend()) == desired);
+    desired = {0,8,1,2,5,3,4};
+    assert(collect(ctree.bfs()) == desired);
+    desired = {1,3,4,2,5,0,8};
+    assert(collect(ctree.post_order()) == desired);
+    desired = {1,3,4,5,8};
+    assert(collect(ctree.leaves()) == desired);
+    desired = {1,2,5};
+    assert(collect(ctree.children(it0)) == desired);
+
+    //mutable views
+    for(auto &val:tree.leaves()){
+        val *= 10;
+    }
+    desired = {0,10,2,30,40,50,80};
+    assert(collect(tree.dfs()) == desired);
+
+    //random-access snapshot
+    auto frozen = tree.freeze();
+    assert(frozen.size() == tree.size());
+    assert(frozen.end() - frozen.begin() == 7);
+    assert(frozen[3] == 30);
+    assert(*(frozen.begin() + 2) == 2);
+    assert(frozen.begin()[6] == 80);
+    assert((frozen.begin() + 2).base() == it2);
+    std::for_each(frozen.begin(), frozen.end(), [](int &val){ val += 1; });
+    std::sort(frozen.begin(), frozen.end(), std::greater<int>());
+    desired = {81,51,41,31,11,3,1};
+    assert(collect(tree.dfs()) == desired);
+    assert(std::accumulate(frozen.begin(), frozen.end(), 0) == 219);
+
+#ifdef __cpp_lib_ranges
+    auto big = ctree.dfs() | std::views::filter([](int val){ return val > 40; });
+    assert(std::ranges::distance(big) == 3);
+    auto all = tree.dfs();
+    assert(std::ranges::find(all, 31) == std::next(tree.begin(), 3));
+#endif
+
+#ifdef HAS_TBB
+    std::for_each(std::execution::par, frozen.begin(), frozen.end(),
+        [](int &val){ val -= 1; });
+    std::sort(std::execution::par, frozen.begin(), frozen.end());
+    desired = {0,2,10,30,40,50,80};
+    assert(collect(tree.dfs()) == desired);
+#endif
+
+    //read-only snapshot of a const tree
+    auto cfrozen = ctree.freeze();
+    assert(cfrozen.size() == tree.size());
+    assert(std::equal(cfrozen.begin(), cfrozen.end(), frozen.begin()));
+    assert((cfrozen.begin() + 2).base() == std::next(ctree.cbegin(), 2));
+    static_assert(std::is_same<decltype(cfrozen.begin().base()), tree_::const_iterator>::value, "");
+
+    tree_ empty;
+    assert(empty.freeze().size() == 0);
+    assert(collect(empty.bfs()).empty());
+    assert(collect(empty.leaves()).empty());
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <random>
+#include <vector>
+#include <utility>
+#include <cassert>
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<int>;
+
+template<class Tree, class Compare>
+void check_sorted(const Tree &tree, Compare cmp){
+    for(auto it = tree.begin(); it != tree.end(); it++){
+        auto prev = it.n->child_begin;
+        if(!prev){
+            continue;
+        }
+        assert(!prev->left);
+        for(auto n = prev->right; n; prev = n, n = n->right){
+            assert(n->left == prev);
+            assert(n->parent == it.n);
+            assert(!cmp(n->value(), prev->value()));
+        }
+        assert(it.n->child_end == prev);
+    }
+}
+
+int main(){
+    /* 0
+       |
+       3-1-2
+         |
+       6-4-5
+     */
+    tree_ tree;
+    auto it0 = tree.set_root(0);
+    tree.append_child(it0, 3);
+    auto it1 = tree.append_child(it0, 1);
+    tree.append_child(it0, 2);
+    auto it6 = tree.append_child(it1, 6);
+    tree.append_child(it1, 4);
+    tree.append_child(it1, 5);
+    tree.sort_children(it0);
+    std::vector<int> desired = {0,1,6,4,5,2,3};
+    std::vector<int> result(tree.begin(), tree.end());
+    assert(result == desired);
+    tree.sort_subtree(it0, std::greater<int>());
+    desired = {0,3,2,1,6,5,4};
+    result.assign(tree.begin(), tree.end());
+    assert(result == desired);
+    //values are not moved, iterators stay valid
+    assert(*it6 == 6 && it6.n->parent == it1.n);
+
+    //stable sort keeps order of equal values
+    using pair_tree = k_tree::tree<std::pair<int, int>>;
+    auto first_less = [](const auto &lhs, const auto &rhs){
+        return lhs.first < rhs.first;
+    };
+    pair_tree pairs;
+    auto pair_root = pairs.set_root(std::make_pair(0, 0));
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 9);
+    for(int i = 0; i < 1000; i++){
+        pairs.append_child(pair_root, std::make_pair(dist(gen), i));
+    }
+    pairs.sort_children(pair_root, first_less);
+    check_sorted(pairs, first_less);
+    for(auto n = pair_root.n->child_begin; n->right; n = n->right){
+        if(n->value().first == n->right->value().first){
+            assert(n->value().second < n->right->value().second);
+        }
+    }
+
+    //big random tree goes through parallel path
+    tree_ big;
+    auto big_root = big.set_root(0);
+    std::vector<tree_::iterator> nodes = {big_root};
+    for(int i = 1; i < 200000; i++){
+        std::uniform_int_distribution<size_t> node_dist(0, nodes.size()-1);
+        auto parent = nodes[node_dist(gen)];
+        nodes.emplace_back(big.append_child(parent, dist(gen)));
+    }
+    big.sort_subtree(big_root);
+    check_sorted(big, std::less<int>());
+    assert(big.size() == nodes.size());
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <numeric>
+#include <algorithm>
+#include <cassert>
+#include "k_tree.hpp"
+
+using tree_ = k_tree::tree<double, k_tree::policy::separate_values>;
+
+template<class Tree>
+auto dfs_values(const Tree &tree){
+    std::vector<typename Tree::value_type> result(tree.cbegin(), tree.cend());
+    return result;
+}
+
+template<class Tree>
+auto sorted_values(const Tree &tree){
+    auto values = tree.values();
+    std::vector<typename Tree::value_type> result(values.begin(), values.end());
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+int main(){
+    tree_ tree;
+    assert(tree.values().begin() == tree.values().end());
+    auto it = tree.set_root(1);
+    for(int i = 2; i <= 100; i++){
+        auto child = tree.append_child(it, i);
+        if(i % 10 == 0){
+            it = child;
+        }
+    }
+    auto values = tree.values();
+    assert(static_cast<size_t>(values.end() - values.begin()) == tree.size());
+    auto sum = std::accumulate(values.begin(), values.end(), 0.0);
+    assert(sum == 5050);
+
+    //values are the same objects as seen through iterators
+    auto max = *std::max_element(values.begin(), values.end());
+    for(auto &val:tree.values()){
+        val /= max;
+    }
+    assert(*tree.begin() == 0.01);
+    assert(*std::prev(tree.end()) == 1);
+
+    //erase keeps array dense
+    auto before = dfs_values(tree);
+    auto second = std::next(tree.begin());
+    before.erase(std::next(before.begin()));
+    tree.erase(second);
+    assert(dfs_values(tree) == before);
+    assert(tree.values().end() - tree.values().begin() == 99);
+    std::sort(before.begin(), before.end());
+    assert(sorted_values(tree) == before);
+
+    //erase of a subtree releases values of all its levels
+    {
+        tree_ nested;
+        auto top = nested.set_root(1);
+        auto middle = nested.append_child(top, 2);
+        nested.append_child(middle, 3);
+        nested.insert_right(top, 4);
+        nested.erase(top);
+        assert(nested.size() == 1);
+        assert(size_t(nested.values().end() - nested.values().begin()) == nested.size());
+        assert(*nested.values().begin() == 4);
+    }
+
+    //compact orders values depth-first
+    tree.compact();
+    auto dfs = dfs_values(tree);
+    values = tree.values();
+    assert(std::vector<double>(values.begin(), values.end()) == dfs);
+
+    //copy, move, clear
+    tree_ copy = tree;
+    assert(copy == tree);
+    assert(sorted_values(copy) == sorted_values(tree));
+    tree_ moved(std::move(copy));
+    assert(moved == tree && copy.empty());
+    assert(copy.values().begin() == copy.values().end());
+    moved.prune_if([](double val){ return val == 0.5; });
+    assert(moved.size() == 48);
+    assert(moved.values().end() - moved.values().begin() == 48);
+    moved.clear();
+    assert(moved.values().begin() == moved.values().end());
+
+    //non-trivial values survive growth of an array
+    using strings = k_tree::tree<std::string, k_tree::policy::separate_values,
+        k_tree::policy::merkle<>>;
+    strings str;
+    std::vector<std::string> words;
+    auto sit = str.set_root("root");
+    for(int i = 0; i < 1000; i++){
+        words.emplace_back("word number " + std::to_string(i));
+    }
+    str.append_children(sit, words.begin(), words.end());
+    auto children = str.children(sit);
+    assert(std::equal(children.begin(), children.end(), words.begin()));
+    auto hash = str.hash();
+    str.erase_if([](const std::string &s){ return s.back() == '7'; });
+    assert(str.size() == 901);
+    str.compact();
+    assert(str.values().begin()[0] == "root");
+    strings rebuilt;
+    auto rit = rebuilt.set_root("root");
+    std::vector<std::string> kept;
+    std::copy_if(words.begin(), words.end(), std::back_inserter(kept),
+        [](const std::string &s){ return s.back() != '7'; });
+    rebuilt.append_children(rit, kept.begin(), kept.end());
+    assert(rebuilt.hash() == str.hash() && rebuilt == str);
+    assert(hash != str.hash());
+
+    //parent arrays
+    auto from = tree_::from_parent_array(std::vector<size_t>{tree_::npos, 0, 0},
+        std::vector<double>{1, 2, 3});
+    assert(from.size() == 3 && *std::next(from.begin(), 2) == 3);
+    values = from.values();
+    assert(std::accumulate(values.begin(), values.end(), 0.0) == 6);
+}